@@ -0,0 +1,148 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// --- BME280 register map (subset used by the burst path) ---
+#define BME280_REG_CALIB_TP 0x88 // dig_T1..dig_P9, 24 bytes
+#define BME280_REG_CALIB_H1 0xA1 // dig_H1, 1 byte
+#define BME280_REG_CALIB_H2 0xE1 // dig_H2..dig_H6, 7 bytes
+#define BME280_REG_CTRL_HUM 0xF2
+#define BME280_REG_STATUS 0xF3
+#define BME280_REG_CTRL_MEAS 0xF4
+#define BME280_REG_CONFIG 0xF5
+#define BME280_REG_DATA 0xF7     // press[3], temp[3], hum[2]
+#define BME280_DATA_LEN 8
+
+#define BME280_STATUS_MEASURING 0x08 // conversion running
+#define BME280_STATUS_IM_UPDATE 0x01 // NVM being copied
+
+#define BME280_MODE_SLEEP 0x00
+#define BME280_MODE_FORCED 0x01
+#define BME280_MODE_NORMAL 0x03
+
+// Register settings for one acquisition configuration. Field values are
+// the raw register codes from the datasheet (osrs_x, filter, t_sb).
+struct BmeConfig
+{
+    uint8_t mode;
+    uint8_t osrsT;
+    uint8_t osrsP;
+    uint8_t osrsH;
+    uint8_t filter;
+    uint8_t standby;
+};
+
+// Raw ADC values taken from one burst read of 0xF7..0xFE
+struct BmeRawFrame
+{
+    int32_t adcP;
+    int32_t adcT;
+    int32_t adcH;
+};
+
+// One compensated reading. Every field comes from the same raw frame,
+// so temperature, humidity and pressure are always coherent. Values stay
+// in the fixed-point formats of the Bosch integer compensation; float is
+// never needed on the sample path.
+struct SensorReading
+{
+    int32_t temperature; // centi-degC
+    uint32_t humidity;   // %RH in Q22.10 (1/1024 %RH)
+    uint32_t pressure;   // Pa in Q24.8 (1/256 Pa)
+};
+
+// When a reading was taken, carried with it to every output. The
+// sequence counts readings of all sensors since boot and never repeats a
+// value within a boot, so a host sees every skipped or lost one.
+struct SampleStamp
+{
+    uint32_t sequence;
+    uint32_t seconds; // RTC wall time at conversion complete, Unix UTC
+    uint32_t micros;  // 0..999999 within seconds
+};
+
+// --- Fixed-point unit conversions (rounded) ---
+static inline uint32_t humidityCenti(uint32_t q10)
+{
+    return (q10 * 100 + 512) >> 10;
+}
+
+static inline uint32_t pressurePa(uint32_t q8)
+{
+    return (q8 + 128) >> 8;
+}
+
+// Driver for the BME280: calibration readout, configuration and burst-read
+// acquisition. One sample costs a single 8-byte I2C read instead of one
+// transaction per quantity.
+class BmeAcquisition
+{
+public:
+    // Reads the trimming parameters. Returns false if the sensor does not ACK.
+    bool begin(uint8_t addr, TwoWire *wire = &Wire);
+
+    // Fetches registers 0xF7..0xFE in one transaction
+    bool readFrame(BmeRawFrame &frame);
+
+    // Runs the Bosch temperature, pressure and humidity compensation on a frame.
+    // Returns false if the frame holds skipped/invalid measurements.
+    bool compensate(const BmeRawFrame &frame, SensorReading &out) const;
+
+    // readFrame() + compensate()
+    bool read(SensorReading &out);
+
+    // Writes ctrl_hum, config and ctrl_meas. The part is put to sleep first,
+    // since config writes are ignored in normal mode.
+    bool configure(const BmeConfig &config);
+
+    // Starts one conversion (forced mode only)
+    bool startForced();
+
+    // Stops a free-running (normal mode) sensor; configure() resumes it
+    bool sleep();
+
+    bool readStatus(uint8_t &status);
+
+    // Datasheet worst-case conversion time for the current config, in us
+    uint32_t measurementTimeUs() const;
+
+    // Datasheet typical conversion time for the current config, in us
+    uint32_t typicalMeasurementTimeUs() const;
+
+    // Normal-mode standby between conversions (t_sb), in us
+    uint32_t standbyTimeUs() const;
+
+private:
+    struct Calibration
+    {
+        uint16_t T1;
+        int16_t T2;
+        int16_t T3;
+        uint16_t P1;
+        int16_t P2;
+        int16_t P3;
+        int16_t P4;
+        int16_t P5;
+        int16_t P6;
+        int16_t P7;
+        int16_t P8;
+        int16_t P9;
+        uint8_t H1;
+        int16_t H2;
+        uint8_t H3;
+        int16_t H4;
+        int16_t H5;
+        int8_t H6;
+    };
+
+    bool readRegisters(uint8_t reg, uint8_t *buf, uint8_t len);
+
+    TwoWire *_wire = nullptr;
+    uint8_t _addr = 0;
+    Calibration _calib = {};
+    BmeConfig _config = {};
+};
+
+#endif // ACQUISITION_H
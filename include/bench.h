@@ -0,0 +1,32 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+// On-target benchmark of the hot-path stages.
+//
+// Runs the sensor read, compensation, screen render and telemetry
+// formatting in a loop through the profiler hooks and checks each
+// stage's mean time against its budget, so a regression on the sample
+// path shows up as a FAIL line on the console ("bench [runs]"). The
+// native suite (test/test_native) holds the host build to the same
+// budgets, scaled for the faster clock.
+// Telemetry is formatted into a sink with stamps of its own, so neither
+// the serial port nor the sample sequence sees it. The sampler is paused
+// for the run, so its transactions never interleave with the bench's
+// reads, and restarts afterwards.
+
+#define BENCH_DEFAULT_RUNS 100
+
+// Budgets, mean us per call at the stock 96 MHz clock
+#define BENCH_BUDGET_SENSOR_READ_US 1200 // 8-byte burst read, leaves room for 100 kHz
+#define BENCH_BUDGET_COMPENSATE_US 50
+#define BENCH_BUDGET_RENDER_US 500
+#define BENCH_BUDGET_TELEMETRY_US 300
+
+// Prints the profile table and one pass/FAIL line per stage.
+// The profiler statistics are reset first. Returns true if every stage
+// that ran met its budget.
+bool benchRun(Print &out, uint16_t runs);
+
+#endif // BENCH_H
@@ -0,0 +1,53 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <Arduino.h>
+
+// Debounced push-button with short, long and double press gestures.
+//
+// The pin's EXTI handler only timestamps the edge and starts a 1 kHz
+// hardware timer. The timer tick does the debouncing (the level must be
+// quiet for BUTTON_DEBOUNCE_MS) and the gesture timing, then publishes
+// events through the lock-free SpscQueue of spsc_queue.h. The
+// main context drains it with buttonPoll(). Latency is bounded by the
+// timer, not by whatever the main loop is doing. A short press is only
+// reported once BUTTON_DOUBLE_MS has passed without a second press.
+// The timer stops again once the button is idle.
+
+#define BUTTON_DEBOUNCE_MS 30 // default, adjustable at runtime
+#define BUTTON_LONG_MS 800   // held this long: long press (reported while held)
+#define BUTTON_DOUBLE_MS 250 // max gap between the presses of a double press
+#define BUTTON_QUEUE_SIZE 8  // power of two
+
+#ifndef BUTTON_TIMER
+#define BUTTON_TIMER TIM9 // TIM10/TIM11 are taken by tone() and Servo
+#endif
+
+enum ButtonEvent
+{
+    BUTTON_SHORT,
+    BUTTON_LONG,
+    BUTTON_DOUBLE
+};
+
+// Configures the (active-low, pulled-up) pin and the tick timer. notify is
+// called from interrupt context whenever an event is queued.
+void buttonBegin(uint32_t pin, void (*notify)(void));
+
+// Edge handler to attach to the pin with CHANGE
+void buttonEdgeInterrupt();
+
+// Debounce/gesture step, run by the timer every millisecond
+void buttonTick();
+
+// Pops the oldest event. Returns false if the queue is empty.
+bool buttonPoll(ButtonEvent &event);
+
+// True while the tick timer runs; the MCU must not enter STOP meanwhile
+bool buttonBusy();
+
+// Quiet time the level needs before a change is accepted
+void buttonSetDebounceMs(uint8_t ms);
+uint8_t buttonDebounceMs();
+
+#endif // BUTTON_H
@@ -0,0 +1,18 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+
+// Line-based serial command console.
+//
+// Input is consumed incrementally from whatever bytes are already waiting,
+// into a small fixed buffer, so polling it never blocks sampling. A line is
+// split into whitespace-separated words and dispatched to the command table.
+
+#define CONSOLE_LINE_MAX 64
+#define CONSOLE_MAX_ARGS 4
+
+// Reads pending input; runs at most one complete command per call
+void consolePoll(Stream &io);
+
+#endif // CONSOLE_H
@@ -0,0 +1,107 @@
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+#include "filter.h"
+
+// Quantities derived from a reading on the device, in integer arithmetic.
+//
+// The logarithms and powers go through a fixed-point log2 (normalise,
+// then one squaring per fraction bit) and exp2 (range reduction to
+// [-0.5, 0.5) and a degree-6 polynomial), so libm never enters the image:
+//
+//   dewpoint      Magnus formula over water, a = 17.62, b = 243.12 C
+//   abs. humidity Magnus saturation pressure, ideal gas, Rv = 461.5 J/kg/K
+//   heat index    NWS: Steadman's simple form, the Rothfusz regression
+//                 from 80 F on, with the low and high humidity adjustments
+//   sea level     station pressure reduced by elevationM, ISA atmosphere
+//   altitude      ISA barometric altitude against qnhPa
+//
+// Each output (FilterOutput) selects the metrics it carries with a bit
+// mask, and keeps its own cache per sensor, so the outputs never share
+// state across threads. A cached metric is recomputed only when one of
+// its inputs moved by more than its DERIVED_*_STEP, or the reference
+// changed.
+
+// Every value is in hundredths of the unit in DerivedInfo
+enum DerivedMetric
+{
+    DERIVED_DEWPOINT,     // centi-degC
+    DERIVED_ABS_HUMIDITY, // centi-g/m^3
+    DERIVED_HEAT_INDEX,   // centi-degC
+    DERIVED_SEA_LEVEL,    // Pa == centi-mBar
+    DERIVED_ALTITUDE,     // cm
+    DERIVED_METRICS
+};
+
+struct DerivedInfo
+{
+    const char *name;   // telemetry key
+    const char *label;  // display, at most 6 characters
+    const char *unit;
+    const char *column; // CSV header
+};
+
+#define DERIVED_BIT(metric) (1u << (metric))
+#define DERIVED_ALL ((1u << DERIVED_METRICS) - 1)
+
+// Input changes below these keep the cached value (all below display resolution)
+#define DERIVED_TEMP_STEP 5   // centi-degC
+#define DERIVED_HUM_STEP 10   // centi-%RH
+#define DERIVED_PRESS_STEP 2  // Pa, about 17 cm of altitude
+
+#define DERIVED_QNH_DEFAULT 101325 // ISA standard atmosphere, Pa
+
+struct DerivedConfig
+{
+    uint32_t qnhPa;                   // sea-level reference pressure for the altitude
+    int16_t elevationM;               // station height for the sea-level pressure
+    uint8_t outputs[FILTER_OUTPUTS];  // DERIVED_BIT mask per output; the log's go to "history"
+};
+
+// Telemetry carries what the hosts used to compute, the display everything, "history" nothing extra
+#define DERIVED_DEFAULT_CONFIG {DERIVED_QNH_DEFAULT, 0, {DERIVED_ALL & ~DERIVED_BIT(DERIVED_ALTITUDE), DERIVED_ALL, 0}}
+
+// A reading in display units: centi-degC, centi-%RH and Pa
+struct DerivedInputs
+{
+    int32_t temperature;
+    uint32_t humidity;
+    uint32_t pressure;
+};
+
+struct DerivedValues
+{
+    int32_t value[DERIVED_METRICS]; // units per DerivedMetric
+    uint8_t mask;                   // metrics held in value
+};
+
+// Applies a configuration and drops every cached value
+void derivedSetConfig(const DerivedConfig &config);
+const DerivedConfig &derivedConfig();
+
+// Metrics selected for out
+uint8_t derivedOutputs(FilterOutput out);
+
+const DerivedInfo &derivedInfo(DerivedMetric metric);
+
+DerivedInputs derivedInputs(const SensorReading &reading);
+
+// Computes the metrics in mask, without the cache
+void derivedCompute(const DerivedInputs &in, uint8_t mask, DerivedValues &out);
+
+// The metrics selected for out, for the reading of the sensor, from the
+// cache of that output where the inputs have not moved enough
+const DerivedValues &derivedFor(FilterOutput out, uint8_t sensor, const SensorReading &reading);
+
+// --- Fixed-point helpers, exposed for the bench ---
+#define DERIVED_LOG_FRAC 24 // fraction bits of log2/exp2 arguments and results
+
+// log2(x) in Q8.24; x must be > 0
+int32_t derivedLog2(uint32_t x);
+
+// 2^y in Q8.24 for y in Q8.24; saturates from y = 7.5
+uint32_t derivedExp2(int32_t y);
+
+#endif // DERIVED_H
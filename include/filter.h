@@ -0,0 +1,84 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+
+// Per-sensor smoothing and report-on-change, between the sampler and the
+// outputs.
+//
+// filterApply() smooths each channel of a fresh reading in place: a
+// median of the last three samples removes single spikes, followed by an
+// exponential moving average with alpha = 1 / 2^emaShift. Everything
+// downstream (display, telemetry, history, log) sees the filtered value.
+//
+// Each output then asks filterDue() whether the reading is worth sending.
+// The answer is yes if any channel moved by more than its deadband since
+// that output last took a reading, or if heartbeatS seconds have passed.
+// Otherwise the sample is skipped, so an output that stays quiet in stable
+// conditions still proves every heartbeat that the board is alive.
+// heartbeatS = 0 switches this off, and every sample is reported.
+
+enum FilterMode
+{
+    FILTER_NONE,
+    FILTER_MEDIAN,
+    FILTER_EMA,
+    FILTER_MEDIAN_EMA,
+    FILTER_MODES
+};
+
+enum FilterChannel
+{
+    FILTER_TEMPERATURE, // deadband in centi-degC
+    FILTER_HUMIDITY,    // deadband in centi-%RH
+    FILTER_PRESSURE,    // deadband in Pa
+    FILTER_CHANNELS
+};
+
+enum FilterOutput
+{
+    FILTER_OUT_TELEMETRY,
+    FILTER_OUT_DISPLAY,
+    FILTER_OUT_LOG,
+    FILTER_OUTPUTS
+};
+
+struct FilterConfig
+{
+    uint8_t mode;     // FilterMode
+    uint8_t emaShift; // 1..FILTER_EMA_SHIFT_MAX
+    uint16_t deadband[FILTER_CHANNELS];
+    uint16_t heartbeatS; // longest silence per output, 0 = report every sample
+};
+
+#define FILTER_EMA_SHIFT_MAX 6
+// Smoothing on, report-on-change off: every sample still reaches every
+// output, as before the filter existed. "set report_s 60" opts in.
+#define FILTER_DEFAULT_CONFIG {FILTER_MEDIAN_EMA, 2, {5, 10, 3}, 0}
+
+// Applies a configuration and restarts every filter and report state
+void filterSetConfig(const FilterConfig &config);
+const FilterConfig &filterConfig();
+
+// Smooths a fresh reading of the sensor in place
+void filterApply(uint8_t sensor, SensorReading &reading);
+
+// True if out should send this reading of the sensor (see above)
+bool filterDue(FilterOutput out, uint8_t sensor, const SensorReading &reading, uint32_t nowMs);
+
+// Records that out sent the reading; the next deadband compares against it
+void filterReported(FilterOutput out, uint8_t sensor, const SensorReading &reading, uint32_t nowMs);
+
+// filterDue() followed by filterReported() when it is, for outputs that
+// always take a due reading
+bool filterReport(FilterOutput out, uint8_t sensor, const SensorReading &reading, uint32_t nowMs);
+
+struct FilterCounts
+{
+    uint32_t offered;  // samples asked about
+    uint32_t reported; // of which sent
+};
+FilterCounts filterCounts(FilterOutput out);
+
+#endif // FILTER_H
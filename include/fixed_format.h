@@ -0,0 +1,21 @@
+#ifndef FIXED_FORMAT_H
+#define FIXED_FORMAT_H
+
+#include <Arduino.h>
+
+// Integer-only decimal formatting for fixed-point values, so the output
+// paths never pull in float printing. value is in units of 10^-decimals.
+
+// Writes value right-aligned in a field of at least width characters.
+// Returns the number of characters written (excluding the terminator).
+size_t formatFixed(char *buf, size_t size, int32_t value, uint8_t decimals, uint8_t width = 0);
+
+void printFixed(Print &out, int32_t value, uint8_t decimals);
+
+// Divides with round-half-away-from-zero, for rescaling signed fixed-point
+static inline int32_t divRound(int32_t value, int32_t divisor)
+{
+    return value >= 0 ? (value + divisor / 2) / divisor : -((-value + divisor / 2) / divisor);
+}
+
+#endif // FIXED_FORMAT_H
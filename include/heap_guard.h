@@ -0,0 +1,39 @@
+#ifndef HEAP_GUARD_H
+#define HEAP_GUARD_H
+
+#include <Arduino.h>
+
+// Keeps the heap from growing once the firmware is up.
+//
+// Every buffer of the firmware is a static object, so after boot nothing
+// should need the heap. What the core and libraries allocate during
+// setup() (Wire buffers, USB, the RTOS task stacks) stays allocated, and
+// freed blocks may be handed out again at the same size. heapGuardLock()
+// freezes the break, the end of the heap: from then on _sbrk() refuses to
+// move it, so a late allocation fails where a growing heap would slowly
+// fragment and eventually run into the stack.
+//
+// The FreeRTOS build takes _sbrk() from the RTOS's newlib heap glue. There
+// the guard cannot refuse, only detect: heapGuardGrown() reports a break
+// that moved since the lock.
+
+struct HeapGuardStats
+{
+    uint32_t staticBytes; // .data + .bss
+    uint32_t lockedBytes; // heap size when locked
+    uint32_t heapBytes;   // heap size now
+    uint32_t refused;     // _sbrk() calls turned down after the lock
+    uint32_t freeBytes;   // between the heap and the stack pointer
+};
+
+// Freezes the heap at its current size; call at the end of the boot
+void heapGuardLock();
+
+bool heapGuardLocked();
+
+// True if the heap grew after heapGuardLock() (always false before it)
+bool heapGuardGrown();
+
+HeapGuardStats heapGuardStats();
+
+#endif // HEAP_GUARD_H
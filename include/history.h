@@ -0,0 +1,80 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+
+// Statically allocated sample history with incremental statistics.
+//
+// Samples are decimated to one per HISTORY_INTERVAL_MS and stored packed
+// (9 bytes) in a ring of HISTORY_CAPACITY entries: 7200 x 2 s = 4 hours.
+// Each block records the wall time of its first sample and each sample
+// its offset from that in seconds, so gaps (screen-off sampling, sensor
+// outages) keep their real timing at 2 bytes per sample.
+// The ring is split into blocks of HISTORY_BLOCK samples, each with its
+// own min/max/sum. Adding a sample updates its block and the running
+// totals in O(1). When the writer wraps into a block, that whole block
+// drops out of the statistics and the global min/max are rebuilt from the
+// remaining block summaries, which is O(HISTORY_BLOCKS) once every
+// HISTORY_BLOCK samples. The statistics window is therefore the most
+// recent (HISTORY_CAPACITY - HISTORY_BLOCK) to HISTORY_CAPACITY samples.
+
+#define HISTORY_CAPACITY 7200
+#define HISTORY_INTERVAL_MS 2000
+#define HISTORY_BLOCK 120 // 4 minutes per summary block
+#define HISTORY_BLOCKS (HISTORY_CAPACITY / HISTORY_BLOCK)
+
+enum HistoryChannel
+{
+    HIST_TEMPERATURE, // centi-degC
+    HIST_HUMIDITY,    // centi-%RH
+    HIST_PRESSURE,    // Pa
+    HIST_CHANNELS
+};
+
+struct __attribute__((packed)) HistorySample
+{
+    int16_t temperature;  // centi-degC
+    uint16_t humidity;    // centi-%RH
+    uint8_t pressure[3];  // Pa, uint24 little-endian
+    uint16_t offset;      // seconds since its block's first sample, saturating
+};
+
+struct HistoryStats
+{
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+    uint16_t count; // samples covered by the statistics window
+};
+
+// Stores the reading if HISTORY_INTERVAL_MS has passed since the last
+// stored one. nowMs drives the decimation, timeS (wall clock seconds) is
+// kept with the sample. Returns true if it was stored.
+bool historyAdd(const SensorReading &reading, uint32_t nowMs, uint32_t timeS);
+
+// Number of samples currently held in the ring
+uint16_t historyCount();
+
+// Samples added since the history was last cleared. Keeps counting once
+// the ring is full, so readers can tell how many arrived since they looked.
+uint32_t historyTotal();
+
+// age 0 is the newest sample. Returns false if age >= historyCount().
+bool historyGet(uint16_t age, HistorySample &out);
+
+int32_t historyValue(const HistorySample &s, HistoryChannel channel);
+
+// Wall clock seconds of the sample at age; false if age >= historyCount()
+bool historyTime(uint16_t age, uint32_t &seconds);
+
+HistoryStats historyStats(HistoryChannel channel);
+
+// Pressure tendency in Pa per 3 hours, from the newest complete block
+// against the oldest one, over the wall time between them. Returns false
+// until two blocks are complete.
+bool historyPressureTrend(int32_t &paPer3h);
+
+void historyClear();
+
+#endif // HISTORY_H
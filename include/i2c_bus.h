@@ -0,0 +1,124 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// I2C bus configuration with per-device clock negotiation and fault recovery.
+//
+// At boot every known device is probed at each candidate clock, fastest
+// first, and the bus runs at the highest clock all present devices pass
+// reliably. At runtime, repeated NACKs or timeouts step the bus down one
+// candidate at a time.
+//
+// A device that resets mid-transfer can hold SDA low, and every further
+// transaction then sits in the core's timeout. The register helpers check
+// that both lines are idle-high before they start, and count the outcome
+// of every transaction in the bus health counters. A stuck line, a timeout
+// or a bus error marks the bus faulted: from then on transactions fail at
+// once instead of waiting for a timeout each, until i2cBusService() gets
+// it back. Recovery clocks SCL by hand until the slave lets go of SDA,
+// sends a STOP and restarts the peripheral. Failed attempts back off
+// exponentially from I2C_BACKOFF_MIN_MS to I2C_BACKOFF_MAX_MS.
+
+#define I2C_CLOCK_STANDARD 100000
+#define I2C_CLOCK_FAST 400000
+#define I2C_CLOCK_FAST_PLUS 1000000
+
+#define I2C_PROBE_REPEATS 8     // consecutive clean transactions required per clock
+#define I2C_ERROR_STEP_DOWN 3   // consecutive runtime failures before slowing down
+#define I2C_BACKOFF_MIN_MS 10   // first retry after a failed recovery
+#define I2C_BACKOFF_MAX_MS 5000
+#define I2C_MAX_BUSES 2
+#define I2C_NO_PIN 0xFFFFFFFF
+
+// Wire status codes (endTransmission)
+#define I2C_STATUS_OK 0
+#define I2C_STATUS_NACK_ADDR 2
+#define I2C_STATUS_NACK_DATA 3
+#define I2C_STATUS_OTHER 4
+#define I2C_STATUS_TIMEOUT 5
+
+// Returns true if the device answered correctly at the current clock
+typedef bool (*I2cProbeFunction)(TwoWire *wire, uint8_t addr);
+
+struct I2cDevice
+{
+    const char *name;
+    uint8_t addr;
+    I2cProbeFunction probe;
+    uint32_t maxClock; // filled in by i2cBusNegotiate(), 0 if absent
+};
+
+// Counters since boot; the 16-bit ones wrap, hosts look at differences
+struct I2cHealth
+{
+    uint32_t transactions;
+    uint16_t nacks;      // address or data NACK, short read
+    uint16_t timeouts;   // reported by the core, or a line found stuck low
+    uint16_t errors;     // arbitration loss, bus error, peripheral busy
+    uint16_t recoveries; // recovery attempts
+};
+
+struct I2cBus
+{
+    TwoWire *wire;
+    uint8_t clockIndex; // index into the candidate table
+    uint8_t errorStreak;
+    uint32_t sda; // pins for the manual recovery, see i2cBusSetPins()
+    uint32_t scl;
+    bool faulted;       // transactions fail fast until recovered
+    uint16_t backoffMs; // wait after the last failed recovery
+    uint32_t retryMs;   // millis() of the next recovery attempt
+    I2cHealth health;
+};
+
+// Registers the bus; the register helpers find it by its TwoWire
+void i2cBusBegin(I2cBus &bus, TwoWire *wire);
+
+// Pins of the bus, needed to detect stuck lines and clock them free.
+// Without them recovery only restarts the peripheral.
+void i2cBusSetPins(I2cBus &bus, uint32_t sda, uint32_t scl);
+
+uint8_t i2cBusCount();
+I2cBus &i2cBusAt(uint8_t index);
+
+// Probes every device and applies the fastest clock they all pass.
+// Prints the outcome to log and returns the chosen clock in Hz.
+uint32_t i2cBusNegotiate(I2cBus &bus, I2cDevice *devices, uint8_t count, Print &log);
+
+uint32_t i2cBusClock(const I2cBus &bus);
+
+// Re-applies the negotiated clock (e.g. after another driver changed it)
+void i2cBusApplyClock(I2cBus &bus);
+
+// Feeds back the outcome of a runtime transaction. After I2C_ERROR_STEP_DOWN
+// consecutive failures the bus drops to the next slower clock.
+void i2cBusRecordResult(I2cBus &bus, bool ok, Print &log);
+
+// --- Fault handling ---
+
+// Runs a due recovery attempt of a faulted bus. Returns true when the bus
+// has just come back; devices on it may have reset and need setting up.
+bool i2cBusService(I2cBus &bus, uint32_t nowMs, Print &log);
+
+// Time of the next recovery attempt; false if the bus is not faulted
+bool i2cBusRetryMs(const I2cBus &bus, uint32_t &atMs);
+
+// True if a transaction may start on wire now: the bus is not faulted and
+// both lines are idle. A stuck line faults the bus.
+bool i2cWireReady(TwoWire *wire);
+
+// Counts a Wire status code against the bus of wire, faulting it on a
+// timeout or bus error. Returns true for I2C_STATUS_OK.
+bool i2cRecordStatus(TwoWire *wire, uint8_t status);
+
+// --- Register access helpers shared by the device drivers ---
+bool i2cReadRegisters(TwoWire *wire, uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+bool i2cWriteRegister(TwoWire *wire, uint8_t addr, uint8_t reg, uint8_t value);
+
+// --- Stock probes ---
+bool i2cProbeBme280(TwoWire *wire, uint8_t addr); // chip id + calibration block readback
+bool i2cProbeSh1106(TwoWire *wire, uint8_t addr); // address ACK + status byte read
+
+#endif // I2C_BUS_H
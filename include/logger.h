@@ -0,0 +1,81 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+
+// Persistent sample log in the spare internal flash of the F411.
+//
+// Flash sectors 5 and 6 (2 x 128 KB at 0x08020000) form a ring; the
+// firmware image is limited to sectors 0..4 and sector 7 holds the
+// settings (settings.h). Records are packed to 12 bytes and batched in RAM,
+// and one 256-byte page (21 records plus a commit word) is programmed
+// at a time. The commit word is written last, so a page cut short by a
+// reset is recognised and skipped. When the active sector is full, the
+// older one is reused; sectors are rotated strictly in turn, so both
+// wear at the same rate. The erase of the older sector stalls the core
+// for about a second, so it never runs on the sample path:
+// loggerService() does it from a low-priority task once the active
+// sector is nearly full, and until then a batch waits in RAM.
+//
+// Each sector starts with a header: magic, a rotation sequence number
+// and an index holding the timestamp of the first record in every page.
+// Seeking to a time needs the two sector headers and an index lookup,
+// never a scan of the data.
+//
+// Timestamps are log seconds: the RTC wall time of the sample (Unix UTC),
+// but never earlier than the newest stored record. A clock that was set
+// back or lost its backup power therefore cannot reorder the log, which
+// the seek relies on; such records share the newest time until the RTC
+// passes it again.
+
+#define LOGGER_INTERVAL_MS 10000 // one record per sensor every 10 s
+#define LOGGER_PAGE_SIZE 256
+#define LOGGER_PAGE_RECORDS 21
+#define LOGGER_DUMP_BATCH 4 // records per binary dump frame
+
+struct __attribute__((packed)) LogRecord
+{
+    uint32_t time;        // log seconds
+    int16_t temperature;  // centi-degC
+    uint16_t humidity;    // centi-%RH
+    uint8_t pressure[3];  // Pa, uint24 little-endian
+    uint8_t sensor;       // registry index
+};
+
+// Scans the sector headers and finds the write position
+void loggerBegin();
+
+// Queues the reading if LOGGER_INTERVAL_MS has passed for this sensor.
+// nowMs drives the decimation, timeS is the sample's wall clock stamp.
+// A full batch is programmed right away. Returns true if it was queued.
+bool loggerAdd(const SensorReading &reading, uint8_t sensor, uint32_t nowMs, uint32_t timeS);
+
+// Programs the pending batch as a (partial) page
+void loggerFlush();
+
+// True once the active sector is nearly full and the older one still
+// has to be erased
+bool loggerServiceDue();
+
+// Erases the older sector ahead of the rotation, dropping its records.
+// Blocks for about a second; call it from a low-priority task.
+void loggerService();
+
+// Erases both sectors (blocks for a few seconds)
+void loggerErase();
+
+// Records in flash plus the ones still batched in RAM
+uint32_t loggerCount();
+
+// Oldest and newest stored times; false if the log is empty
+bool loggerSpan(uint32_t &oldest, uint32_t &newest);
+
+// Current log time in seconds: the RTC, or the newest record if that is later
+uint32_t loggerNow();
+
+// Streams every record with time >= since as COBS-framed dump packets.
+// Returns the number of records sent.
+uint32_t loggerDump(Print &out, uint32_t since);
+
+#endif // LOGGER_H
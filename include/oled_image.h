@@ -0,0 +1,97 @@
+#ifndef OLED_IMAGE_H
+#define OLED_IMAGE_H
+
+#include <Arduino.h>
+#include "oled_glyphs.h"
+
+// Compile-time screen images.
+//
+// A static screen is declared as a constexpr list of text lines (plus an
+// optional border). oledScreen() renders it into a full page-major frame
+// during compilation, and the result sits in flash as a ready-made
+// image. Showing it at runtime is one 1 KB copy into the framebuffer,
+// with no text layout, no bounds calculation and no formatting.
+//
+//   static constexpr OledImage readyScreen = oledScreen(false, oledLine(3, "Ready!"));
+
+#define OLED_PAGES 8
+#define OLED_WIDTH 128
+#define OLED_HEIGHT (OLED_PAGES * 8)
+#define OLED_CENTRED INT16_MIN // x for a horizontally centred line
+
+struct OledTextLine
+{
+    uint8_t page;
+    int16_t x;
+    const char *text;
+};
+
+struct OledImage
+{
+    uint8_t data[OLED_PAGES * OLED_WIDTH];
+};
+
+constexpr OledTextLine oledLine(uint8_t page, const char *text)
+{
+    return OledTextLine{page, OLED_CENTRED, text};
+}
+
+constexpr OledTextLine oledLineAt(uint8_t page, int16_t x, const char *text)
+{
+    return OledTextLine{page, x, text};
+}
+
+constexpr void oledImageText(OledImage &img, const OledTextLine &line)
+{
+    int16_t x = line.x == OLED_CENTRED ? (OLED_WIDTH - glyphTextWidth(line.text)) / 2 : line.x;
+    for (const char *c = line.text; *c; c++, x += GLYPH_ADVANCE)
+    {
+        for (int16_t i = 0; i < GLYPH_ADVANCE; i++)
+        {
+            int16_t col = x + i;
+            if (col < 0 || col >= OLED_WIDTH || line.page >= OLED_PAGES)
+            {
+                continue;
+            }
+            uint8_t bits = 0;
+            if (i < GLYPH_WIDTH && *c >= GLYPH_FIRST && *c <= GLYPH_LAST)
+            {
+                bits = glyphFont[*c - GLYPH_FIRST][i];
+            }
+            img.data[line.page * OLED_WIDTH + col] = bits;
+        }
+    }
+}
+
+// One-pixel rectangle around the whole panel
+constexpr void oledImageBorder(OledImage &img)
+{
+    for (uint16_t x = 0; x < OLED_WIDTH; x++)
+    {
+        img.data[x] |= 0x01;
+        img.data[(OLED_PAGES - 1) * OLED_WIDTH + x] |= 0x80;
+    }
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+    {
+        img.data[p * OLED_WIDTH] = 0xFF;
+        img.data[p * OLED_WIDTH + OLED_WIDTH - 1] = 0xFF;
+    }
+}
+
+template <typename... Lines>
+constexpr OledImage oledScreen(bool border, Lines... lines)
+{
+    OledImage img{};
+    const OledTextLine all[] = {lines...};
+    for (const OledTextLine &line : all)
+    {
+        oledImageText(img, line);
+    }
+    if (border)
+    {
+        oledImageBorder(img);
+    }
+    return img;
+}
+
+#endif // OLED_IMAGE_H
@@ -0,0 +1,83 @@
+#ifndef OLED_RENDERER_H
+#define OLED_RENDERER_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "acquisition.h"
+#include "oled_image.h"
+
+// Incremental renderer for the SH1106 sensor screen.
+//
+// The static parts of the sensor screen (frame, labels, units) are drawn
+// once; afterwards only value fields whose formatted text changed are
+// redrawn. oledRendererFlush() sends only the changed column span of each
+// changed page, instead of the whole 1 KB frame.
+//
+// The framebuffer is double-buffered: drawing goes into one buffer while
+// the other is being sent, and a flush swaps them between passes. Drawing
+// during a pass is safe and never shows up half-done on the panel.
+//
+// Flushing is asynchronous when the transport uses DMA: oledRendererFlush()
+// starts a pass and oledRendererPoll() keeps it going page by page, so
+// other work can run while the panel updates.
+
+// Initialises the SH1106, blanks its RAM and switches it on.
+// Returns false if the panel does not ACK.
+bool oledRendererBegin(TwoWire *wire, uint8_t addr);
+
+// Panel RAM is unknown (after begin() or power-up): the next flush sends every page
+void oledRendererInvalidatePanel();
+
+// Clears the framebuffer. The sensor screen layout is redrawn on its next update.
+void oledRendererClear();
+
+// Draws the sensor screen into the framebuffer, touching only changed fields.
+// tag (optional) names the sensor, for boards with more than one.
+void oledRendererSensorScreen(const SensorReading &reading, const char *tag = nullptr);
+
+// Replaces the framebuffer with a compile-time screen image
+void oledRendererShowImage(const OledImage &image);
+
+// Draws text on a page row of the framebuffer with the glyph cache
+void oledRendererText(uint8_t page, int16_t x, const char *text);
+void oledRendererCenteredText(uint8_t page, const char *text);
+
+// --- Graph screens: title text on page 0, plot on the pages below ---
+#define OLED_GRAPH_PAGE 1 // first plot page
+#define OLED_GRAPH_HEIGHT ((OLED_PAGES - OLED_GRAPH_PAGE) * 8) // plot rows
+
+// Clears the framebuffer for a graph. Title text goes on page 0 with
+// oledRendererText().
+void oledRendererGraphBegin();
+
+// True while the framebuffer still holds the graph set up by
+// oledRendererGraphBegin(): nothing else has been drawn over it since.
+bool oledRendererGraphShown();
+
+// Sets plot column x to a vertical line from row y0 to row y1 (0 = bottom,
+// OLED_GRAPH_HEIGHT - 1 = top) and clears the rest of the column. Joining
+// each sample to the previous one keeps steep slopes continuous. Negative
+// rows give an empty column.
+void oledRendererGraphColumn(uint8_t x, int8_t y0, int8_t y1);
+
+// Swaps the drawn frame to the front and starts sending its changed spans.
+// If a pass is already running the swap waits until it finishes.
+void oledRendererFlush();
+
+// Advances a running flush. Returns true while the pass is still in progress.
+bool oledRendererPoll();
+
+// Flushes and waits for the pass to complete (boot-time screens)
+void oledRendererFlushWait();
+
+// Switches the panel off (DISPLAYOFF) or back on (DISPLAYON). Panel RAM,
+// the controller setup and the framebuffer are all kept, so waking needs
+// no re-init and no redraw. A running flush is finished before going dark.
+// Returns false if the panel did not ACK; it then needs a full begin().
+bool oledRendererSetPower(bool on);
+bool oledRendererPowered();
+
+// Bytes of pixel data sent since boot, for bus-traffic accounting
+uint32_t oledRendererBytesSent();
+
+#endif // OLED_RENDERER_H
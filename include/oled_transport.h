@@ -0,0 +1,49 @@
+#ifndef OLED_TRANSPORT_H
+#define OLED_TRANSPORT_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Page-write transport for the SH1106.
+//
+// Each call sends one column span of one page as a single I2C transaction
+// (page/column address + data). On the STM32F411 the transaction is handed
+// to the I2C1 TX DMA stream and the call returns immediately; elsewhere,
+// or if DMA cannot be set up, it falls back to blocking Wire writes.
+// The span is copied into a staging buffer, so the caller may keep drawing
+// into its framebuffer while the transfer is in flight.
+
+#define OLED_COLUMN_OFFSET 2 // SH1106 RAM is 132 columns wide, the 128 visible start at 2
+
+#define SH1106_DISPLAYOFF 0xAE
+#define SH1106_DISPLAYON 0xAF
+
+typedef void (*OledTransportCallback)();
+
+// Returns true if the DMA path is active, false for the blocking fallback
+bool oledTransportBegin(TwoWire *wire, uint8_t addr);
+
+// Starts sending len bytes at visible column col of page.
+// Returns false (and sends nothing) if a transfer is still in flight.
+bool oledTransportSendPage(uint8_t page, uint8_t col, const uint8_t *data, uint8_t len);
+
+// True while a DMA transfer is in flight. The bus must not be used meanwhile.
+bool oledTransportBusy();
+
+// Waits (bounded by one page transfer) until the bus is free for other devices
+void oledTransportWaitIdle();
+
+// Detects completion and runs the completion callback from the caller's context
+void oledTransportPoll();
+
+void oledTransportOnComplete(OledTransportCallback cb);
+
+// Sends one command byte with a blocking write once the bus is free.
+// Returns false if the panel did not ACK.
+bool oledTransportCommand(uint8_t cmd);
+
+// Sends the controller setup for a 128x64 SH1106 module. The panel is left
+// dark so that its (random) RAM can be overwritten before DISPLAYON.
+bool oledTransportInitPanel();
+
+#endif // OLED_TRANSPORT_H
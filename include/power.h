@@ -0,0 +1,36 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+// Low-power idle for the screen-off state.
+//
+// With the screen off the MCU enters STOP mode between scheduler
+// deadlines. The button EXTI (and the RTC alarm when a deadline is armed,
+// e.g. background logging) wakes it. SysTick does not run in STOP, so the
+// time actually slept is measured on the RTC and added back to the tick
+// counter; millis()/micros() deadlines stay valid across a sleep.
+//
+// USB CDC loses its clock in STOP, so the serial link is unavailable
+// while the device sleeps. Build with -D POWER_USE_STOP=0 to keep it
+// alive and fall back to WFI idling.
+
+#ifndef POWER_USE_STOP
+#if defined(ARDUINO_ARCH_STM32)
+#define POWER_USE_STOP 1
+#else
+#define POWER_USE_STOP 0
+#endif
+#endif
+
+#define POWER_MIN_STOP_US 5000 // shorter gaps are not worth the STOP entry/exit cost
+
+// Sets up the low-power library on the RTC started by rtcTimeBegin(), and
+// attaches the wake-up capable button interrupt in place of attachInterrupt().
+void powerBegin(uint32_t wakePin, void (*isr)(void), uint32_t mode);
+
+// Sleeps for at most maxSleepUs (UINT32_MAX: until the next interrupt).
+// Uses STOP mode when enabled and the gap is long enough, WFI otherwise.
+void powerIdle(uint32_t maxSleepUs);
+
+#endif // POWER_H
@@ -0,0 +1,72 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// Section timing on the Cortex-M4 DWT cycle counter.
+//
+// Each named section keeps count, min, max, total and a decade histogram
+// in a static table; timing a section costs two counter reads. The
+// console "prof" command prints the table and "bench" runs the hot-path
+// stages in a loop and checks them against their budgets (bench.h).
+//
+// Builds without a DWT (host) fall back to micros(). Build with
+// -D PROFILER_ENABLE=0 to compile all hooks out.
+
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE 1
+#endif
+
+enum ProfileSection
+{
+    PROF_SENSOR_READ, // burst read of the data registers
+    PROF_COMPENSATE,  // Bosch integer compensation
+    PROF_RENDER,      // sensor screen into the framebuffer
+    PROF_FLUSH,       // CPU time to diff and start a flush pass
+    PROF_TELEMETRY,   // formatting a sample into the serial queue
+    PROF_LOGGER,      // programming a flash log page
+    PROF_SECTIONS
+};
+
+#define PROFILE_BUCKETS 6 // <1 us, <10 us, <100 us, <1 ms, <10 ms, longer
+
+struct ProfileStats
+{
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[PROFILE_BUCKETS];
+};
+
+#if PROFILER_ENABLE
+
+// Starts the cycle counter
+void profilerBegin();
+
+// Counter value marking the start of a section
+uint32_t profilerStart();
+
+void profilerStop(ProfileSection section, uint32_t start);
+
+#else
+
+static inline void profilerBegin() {}
+static inline uint32_t profilerStart() { return 0; }
+static inline void profilerStop(ProfileSection, uint32_t) {}
+
+#endif
+
+void profilerReset();
+
+const ProfileStats &profilerStats(ProfileSection section);
+
+const char *profilerName(ProfileSection section);
+
+// Converts counter ticks to microseconds
+uint32_t profilerCyclesToUs(uint64_t cycles);
+
+// One line per section that has run: count, min/mean/max us, histogram
+void profilerReport(Print &out);
+
+#endif // PROFILER_H
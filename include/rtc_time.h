@@ -0,0 +1,49 @@
+#ifndef RTC_TIME_H
+#define RTC_TIME_H
+
+#include <Arduino.h>
+
+// Wall-clock time for sample stamps, from the F411 RTC on the LSE crystal.
+//
+// The RTC calendar only resolves milliseconds and takes several register
+// reads, so it is not read per sample. Instead a micros() epoch is lined
+// up with it every RTC_TIME_RESYNC_US, and stamps are that epoch plus the
+// elapsed micros(): microsecond resolution, one RTC read every 10 s. With
+// the RTC kept in the backup domain (VBAT), time survives resets; until
+// it is set from the host it counts from 2000-01-01.
+//
+// Stamps never go back while the clock is not set: when a resync finds
+// micros() ran ahead of the RTC, stamps advance by 1 us per call until the
+// RTC catches up. rtcTimeSet() alone may step the time back.
+//
+// The LSE can be trimmed with the RTC smooth calibration, in ppm: positive
+// values slow an RTC that gains, negative ones speed up one that loses.
+//
+// Host builds have no RTC; their wall time starts at 0 with the program.
+
+#define RTC_TIME_RESYNC_US 10000000UL
+#define RTC_CALIBRATION_MAX_PPM 487 // 511 masked pulses in a 32 s window
+
+struct RtcTime
+{
+    uint32_t seconds; // Unix time, UTC
+    uint32_t micros;  // 0..999999
+};
+
+// Starts the RTC on the LSE; keeps the time it already holds
+void rtcTimeBegin();
+
+// Current wall time, monotonic between rtcTimeSet() calls
+void rtcTimeNow(RtcTime &t);
+uint32_t rtcTimeSeconds();
+
+// Sets the calendar to Unix time seconds
+void rtcTimeSet(uint32_t seconds);
+
+// False until the time was set since the backup domain last lost power
+bool rtcTimeIsSet();
+
+// Applies a smooth calibration of -RTC_CALIBRATION_MAX_PPM..+RTC_CALIBRATION_MAX_PPM
+bool rtcTimeSetCalibration(int16_t ppm);
+
+#endif // RTC_TIME_H
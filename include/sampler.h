@@ -0,0 +1,98 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+#include "sensors.h"
+
+// Acquisition profiles and the status-polling sample state machine.
+//
+// The state machine runs every ready sensor in the registry at once.
+// Forced-mode profiles trigger all sensors on a fixed-rate clock, wait
+// the datasheet conversion time once, and then poll the status of every
+// sensor that is still converting until its measuring bit clears. N
+// sensors therefore cost one conversion time, not N. Normal-mode profiles
+// let the sensors free-run. Each sensor is left alone for a typical
+// conversion cycle (t_measure + t_standby) after its last reading, then
+// its data registers are read every poll until the frame changes, or
+// until a worst-case cycle guarantees a new conversion. The measuring bit
+// is not used, because it is clear for only t_sb per cycle. With a poll
+// period below the cycle, each conversion is read exactly once.
+
+enum SamplingProfileId
+{
+    PROFILE_WEATHER, // forced, 1x oversampling, sensor sleeps between samples
+    PROFILE_HVAC,    // normal, moderate IIR, ~7 Hz
+    PROFILE_FAST,    // normal, 0.5 ms standby, x16 pressure, IIR 16, max ODR
+    PROFILE_COUNT
+};
+
+struct SamplingProfile
+{
+    const char *name;
+    BmeConfig config;
+    uint16_t periodMs; // forced: trigger period; normal: status poll period
+};
+
+extern const SamplingProfile samplingProfiles[PROFILE_COUNT];
+
+// Looks a profile up by name; returns PROFILE_COUNT if unknown
+SamplingProfileId samplerFindProfile(const char *name);
+
+// Configures the ready sensors for the given profile and restarts the
+// state machine. Returns false if any of them rejected the configuration.
+bool samplerSetProfile(SamplingProfileId id);
+SamplingProfileId samplerProfile();
+
+// Overrides the profile's period (0 restores it). In forced mode this is
+// the sample rate. In normal mode it is the poll period and the shortest
+// time between two readings of a sensor, so readings arrive at whichever
+// is slower, the period or the sensor's own ODR.
+void samplerSetPeriodMs(uint16_t ms);
+uint16_t samplerPeriodMs(); // the period in effect
+
+// Reads the calibration of every registered sensor that is not ready yet
+// and applies the current profile to it. Returns the number of ready sensors.
+uint8_t samplerStartSensors();
+
+// Advances the state machine. New readings are stored in the registry.
+// Returns a bit mask of the sensors with a new reading; failed gets the
+// mask of sensors whose I2C transaction failed.
+uint8_t samplerPoll(uint32_t nowUs, uint8_t &failed);
+
+// While paused, samplerPoll() leaves the sensors alone and returns no
+// readings, so a caller can use the bus. Resuming restarts the state
+// machine, as a profile change does.
+void samplerPause(bool pause);
+
+// Absolute micros() deadline at which samplerPoll() wants to run next
+uint32_t samplerNextPollUs();
+
+// Stamps a reading with the wall clock and the next sequence number. The
+// state machine stamps its own readings; this is for readings taken
+// outside it, so they share the one sequence.
+void samplerStamp(SampleStamp &stamp);
+
+// --- Offline sensors ---
+//
+// After SENSOR_OFFLINE_FAILS consecutive failed transactions a sensor is
+// taken out of sampling, so a missing device costs nothing per cycle.
+// samplerReconnect() retries it with exponential backoff, from
+// SENSOR_BACKOFF_MIN_MS to SENSOR_BACKOFF_MAX_MS, while its bus is not
+// faulted.
+
+#define SENSOR_OFFLINE_FAILS 3
+#define SENSOR_BACKOFF_MIN_MS 100
+#define SENSOR_BACKOFF_MAX_MS 30000
+
+// Attempts the due reconnects. Returns the mask of sensors back online.
+uint8_t samplerReconnect(uint32_t nowMs);
+
+// Earliest reconnect attempt; false if no sensor is offline
+bool samplerNextReconnectMs(uint32_t &atMs);
+
+// Takes every sensor of bus offline and makes its reconnect due at once.
+// For a bus that just recovered: its sensors may have reset with it.
+void samplerReconnectBus(const I2cBus *bus);
+
+#endif // SAMPLER_H
@@ -0,0 +1,49 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Cooperative, deadline-driven task scheduler.
+//
+// Tasks run to completion from loop() in registration order, so a task
+// registered earlier has priority when several become due at once.
+// Periodic tasks run on a fixed-rate clock: the next deadline is the
+// previous deadline plus the period, not "now" plus the period, so time
+// spent inside a task does not make the schedule drift.
+
+#define SCHEDULER_MAX_TASKS 16
+
+typedef void (*TaskFunction)(uint32_t nowUs);
+
+// Registers a task that runs every periodUs. Returns its id, or -1 if the table is full.
+int schedulerAddPeriodic(const char *name, TaskFunction fn, uint32_t periodUs);
+
+// Registers a task that runs only when signalled or woken. Returns its id, or -1.
+int schedulerAddEvent(const char *name, TaskFunction fn);
+
+// Marks an event task ready to run on the next pass. Safe to call from an ISR.
+void schedulerSignal(int id);
+
+// Arms a one-shot deadline for an event task (absolute / relative to now)
+void schedulerWakeAt(int id, uint32_t deadlineUs);
+void schedulerWakeIn(int id, uint32_t delayUs);
+
+// Changes the period of a periodic task; the new period applies from the next deadline
+void schedulerSetPeriod(int id, uint32_t periodUs);
+
+// Disabled tasks keep their registration but never run. Re-enabling a
+// periodic task restarts its clock from now.
+void schedulerEnable(int id, bool enabled);
+
+// Runs every task that is due. Call once per loop() pass.
+// Returns true if at least one task ran.
+bool schedulerRun();
+
+// Microseconds until the earliest pending deadline (0 if something is due,
+// UINT32_MAX if nothing is armed)
+uint32_t schedulerTimeToNextUs();
+
+// Sleeps the core until the next interrupt when nothing is due
+void schedulerIdle();
+
+#endif // SCHEDULER_H
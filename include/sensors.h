@@ -0,0 +1,51 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+#include "i2c_bus.h"
+
+// Registry of the BME280s found on the I2C buses.
+//
+// Each sensor keeps its own driver state and its latest reading. Sensors
+// are numbered in discovery order; sensor 0 is the primary one (history,
+// background logging). The sampler drives all registered sensors
+// together, so conversions overlap instead of running back to back.
+
+#define SENSOR_MAX 4
+#define SENSOR_LABEL_LEN 6 // "2:77" + terminator, rounded up
+
+struct Sensor
+{
+    I2cBus *bus;
+    uint8_t busNumber; // 1-based, for labels
+    uint8_t addr;
+    bool ready;        // calibration read and profile applied
+    BmeAcquisition bme;
+    SensorReading reading;
+    bool valid;         // reading holds a good sample
+    uint32_t readingMs; // when reading was taken, millis()
+    SampleStamp stamp;  // the same on the wall clock
+    uint8_t failStreak; // consecutive failed transactions
+    uint16_t backoffMs; // offline: wait after the last failed reconnect, 0 if online
+    uint32_t retryMs;   // offline: millis() of the next reconnect attempt
+};
+
+// Registers a BME280 at addr. Returns its index, the existing index if it
+// is already known, or -1 if the registry is full.
+int sensorsAdd(I2cBus *bus, uint8_t busNumber, uint8_t addr);
+
+// Probes the two BME280 addresses (0x76, 0x77) on a bus and registers
+// every sensor that answers. Returns how many are registered in total.
+uint8_t sensorsDiscover(I2cBus *bus, uint8_t busNumber);
+
+uint8_t sensorCount();
+Sensor &sensorAt(uint8_t index);
+
+// Number of sensors that are ready for sampling
+uint8_t sensorsReady();
+
+// Short human-readable tag, e.g. "1:76"
+void sensorLabel(uint8_t index, char *buf, size_t size);
+
+#endif // SENSORS_H
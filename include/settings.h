@@ -0,0 +1,70 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include "filter.h"
+#include "derived.h"
+
+// Persistent runtime settings, kept in the last flash sector of the F411
+// (sector 7, 128 KB). Each save appends a record to the next blank slot
+// of the sector; the newest valid record is the one in force, and the
+// sector is erased only when every slot is used. A record carries a
+// magic, a layout version and a CRC, programmed last; anything that does
+// not check out falls back to defaults. The block the core's EEPROM
+// emulation left at the start of the sector reads as the first record.
+//
+// A change only marks the settings dirty. settingsCommit() writes them
+// SETTINGS_SAVE_DELAY_MS after the last change, from a low-priority
+// task, so a burst of console commands costs one record.
+
+#define SETTINGS_MAGIC 0x53544d54 // "STMT"
+#define SETTINGS_VERSION 5
+#define SETTINGS_SAVE_DELAY_MS 3000 // changes closer than this share one record
+#define SETTINGS_RETRY_MAX_MS 60000 // longest wait between retries of a failed write
+
+// Ranges the console accepts. settingsLoad() puts every stored field
+// outside its range back to the default, so a corrupt or foreign record
+// that still checks out can never configure the device beyond them.
+#define SETTINGS_PERIOD_MS_MAX 60000
+#define SETTINGS_DEBOUNCE_MS_MIN 1
+#define SETTINGS_DEBOUNCE_MS_MAX 200
+#define SETTINGS_QNH_PA_MIN 80000
+#define SETTINGS_QNH_PA_MAX 110000
+#define SETTINGS_DEADBAND_MAX 1000
+#define SETTINGS_REPORT_S_MAX 3600
+#define SETTINGS_ELEVATION_M_MIN -500
+#define SETTINGS_ELEVATION_M_MAX 9000
+
+struct Settings
+{
+    uint8_t profile;         // SamplingProfileId
+    uint8_t telemetryFormat; // TelemetryFormat
+    uint8_t debounceMs;      // button debounce
+    uint16_t periodMs;       // sample period override, 0 = the profile's own
+    FilterConfig filter;     // smoothing and report-on-change
+    int16_t rtcPpm;          // RTC smooth calibration, see rtcTimeSetCalibration()
+    DerivedConfig derived;   // pressure references and metrics per output
+};
+
+extern Settings settings;
+
+// Loads the stored block, or defaults if none is valid. Returns true if loaded.
+bool settingsLoad();
+
+// Marks the settings changed and calls the hook set with settingsOnDirty()
+void settingsMarkDirty();
+
+// The hook arms whatever runs settingsCommit() after SETTINGS_SAVE_DELAY_MS
+void settingsOnDirty(void (*hook)());
+
+bool settingsDirty();
+
+// Appends the current settings if they are dirty and differ from the
+// newest record. Erases the sector first if it is full (blocks for about
+// a second). Returns false if the flash could not be written; the
+// settings then stay dirty, for the caller to retry.
+bool settingsCommit();
+
+void settingsDefaults(Settings &s);
+
+#endif // SETTINGS_H
@@ -0,0 +1,54 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+
+// Lock-free single-producer/single-consumer ring, for handing items from
+// one task (or ISR) to another. The producer owns head and the consumer
+// owns tail; each index is published only after the slot it covers has
+// been written or read, which is all the ordering a single-core
+// Cortex-M needs. Size must be a power of two; one slot stays empty.
+
+template <typename T, uint8_t Size>
+class SpscQueue
+{
+    static_assert((Size & (Size - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    // Returns false (and drops the item) if the queue is full
+    bool push(const T &item)
+    {
+        uint8_t h = head;
+        uint8_t next = (uint8_t)((h + 1) & (Size - 1));
+        if (next == tail)
+        {
+            return false;
+        }
+        slots[h] = item;
+        __asm__ volatile("" ::: "memory"); // slot before index
+        head = next;
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        uint8_t t = tail;
+        if (t == head)
+        {
+            return false;
+        }
+        item = slots[t];
+        __asm__ volatile("" ::: "memory");
+        tail = (uint8_t)((t + 1) & (Size - 1));
+        return true;
+    }
+
+    bool empty() const { return head == tail; }
+
+private:
+    T slots[Size];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+};
+
+#endif // SPSC_QUEUE_H
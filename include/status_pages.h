@@ -0,0 +1,25 @@
+#ifndef STATUS_PAGES_H
+#define STATUS_PAGES_H
+
+#include <Arduino.h>
+
+// Text pages for the page manager (ui_pages.h): derived metrics, history
+// statistics, bus and sensor health, and the profiler table. Each keeps the text of its rows,
+// so only rows whose text changed are redrawn.
+
+#define STATUS_COLUMNS 21 // 128 px / GLYPH_ADVANCE
+
+// Derived metrics of the sensor arg, those the display output selects
+bool statusPageDerived(uint8_t arg, bool full);
+bool statusPageDerivedAvailable(uint8_t arg);
+
+// History min/max per channel, sample count and pressure trend
+bool statusPageStats(uint8_t arg, bool full);
+
+// Per-bus clock, state and error counters; which sensors are online
+bool statusPageHealth(uint8_t arg, bool full);
+
+// Mean and max time of each profiled section
+bool statusPageProfile(uint8_t arg, bool full);
+
+#endif // STATUS_PAGES_H
@@ -0,0 +1,112 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "acquisition.h"
+#include "i2c_bus.h"
+#include "derived.h"
+
+// Serial telemetry in one of two formats:
+//
+// TELEMETRY_TEXT   Teleplot lines (">Temp:23.4§C"), human readable. Sensors
+//                  other than the primary one get their index appended
+//                  to the name (">Temp_1:23.4§C").
+// TELEMETRY_BINARY COBS-framed packets terminated by 0x00, decoded on the
+//                  host by tools/telemetry_decode.py
+//
+// Binary sample packet, little-endian, before COBS encoding:
+//
+//   offset size field
+//   0      1    type (TELEMETRY_PKT_SAMPLE)
+//   1      2    frame sequence number, wraps at 65536
+//   3      4    sample sequence number (SampleStamp)
+//   7      4    RTC time of the conversion, Unix seconds UTC
+//   11     4    microseconds within that second
+//   15     2    temperature, int16 centi-degC
+//   17     4    pressure, uint32 Pa in Q24.8
+//   21     2    humidity, uint16 centi-%RH
+//   23     1    sensor index in the registry
+//   24     2    CRC-16/CCITT-FALSE over bytes 0..23
+//
+// 26 bytes of payload, 28 on the wire with the COBS overhead byte and the
+// frame delimiter. A gap in the frame sequence is a lost frame; a gap in
+// the sample sequence alone is a reading the report filter held back.
+//
+// Log dump packet (console "log dump"):
+//
+//   0      1    type (TELEMETRY_PKT_LOG)
+//   1      1    record count n (1..LOGGER_DUMP_BATCH)
+//   2      12n  LogRecord entries, see logger.h
+//   2+12n  2    CRC-16/CCITT-FALSE over the preceding bytes
+//
+// I2C health packet, sent when a bus's counters changed (see I2cHealth):
+//
+//   0      1    type (TELEMETRY_PKT_HEALTH)
+//   1      1    bus number, 1-based
+//   2      4    timestamp, ms since boot
+//   6      4    transactions
+//   10     2    NACKs
+//   12     2    timeouts
+//   14     2    bus errors
+//   16     2    recovery attempts
+//   18     2    bus clock, kHz
+//   20     2    CRC-16/CCITT-FALSE over bytes 0..19
+//
+// In text format the same counters go out as ">I2C1_nack:3" lines.
+//
+// Derived metrics packet, after the sample it was computed from when the
+// telemetry output selects any (see derived.h):
+//
+//   0      1    type (TELEMETRY_PKT_DERIVED)
+//   1      4    sample sequence number, as in the sample packet
+//   5      1    sensor index
+//   6      1    metric mask, DERIVED_BIT per DerivedMetric
+//   7      4n   int32 per metric in the mask, in DerivedMetric order
+//   7+4n   2    CRC-16/CCITT-FALSE over the preceding bytes
+//
+// In text format each metric is a line of its own (">Dewpoint:11.98§C").
+
+enum TelemetryFormat
+{
+    TELEMETRY_TEXT,
+    TELEMETRY_BINARY,
+};
+
+#ifndef TELEMETRY_DEFAULT_FORMAT
+#define TELEMETRY_DEFAULT_FORMAT TELEMETRY_TEXT
+#endif
+
+#define TELEMETRY_PKT_SAMPLE 0x01
+#define TELEMETRY_PKT_LOG 0x02
+#define TELEMETRY_PKT_HEALTH 0x03
+#define TELEMETRY_PKT_DERIVED 0x04
+#define TELEMETRY_SAMPLE_LEN 26
+#define TELEMETRY_HEALTH_LEN 22
+#define TELEMETRY_MAX_FRAME 64 // largest encoded frame, including the delimiter
+
+void telemetrySetFormat(TelemetryFormat format);
+TelemetryFormat telemetryFormat();
+
+// Emits one sample of the given sensor in the current format
+void telemetryWriteSample(Print &out, const SensorReading &reading, const SampleStamp &stamp, uint8_t sensor);
+
+// Emits the metrics in values.mask, derived from the sample with stamp
+void telemetryWriteDerived(Print &out, const DerivedValues &values, const SampleStamp &stamp, uint8_t sensor);
+
+// Emits the health counters of an I2C bus in the current format
+void telemetryWriteHealth(Print &out, uint8_t busNumber, const I2cHealth &health, uint32_t clockHz,
+                          uint32_t timestampMs);
+
+// --- Framing primitives, shared with other binary producers ---
+uint16_t telemetryCrc16(const uint8_t *data, size_t len);
+
+// Fills the last two bytes of pkt with the CRC of the rest, COBS-encodes
+// it and writes the frame. len includes the CRC and must not exceed
+// TELEMETRY_MAX_FRAME - 2.
+void telemetryWriteFrame(Print &out, uint8_t *pkt, size_t len);
+
+// COBS-encodes len bytes into out and appends the 0x00 delimiter.
+// out must hold len + len / 254 + 2 bytes. Returns the encoded length.
+size_t telemetryCobsEncode(const uint8_t *data, size_t len, uint8_t *out);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,70 @@
+#ifndef TELEMETRY_WRITER_H
+#define TELEMETRY_WRITER_H
+
+#include <Arduino.h>
+#ifdef USE_FREERTOS
+#include <STM32FreeRTOS.h>
+#endif
+
+// Buffered, non-blocking serial output.
+//
+// Serial is a USB full-speed CDC endpoint, where every write() can turn
+// into its own short USB packet and a host that stops reading makes
+// write() block. Everything the firmware prints while running goes into
+// this ring instead and leaves in one write per batch: poll() sends the
+// whole buffer if the endpoint has room for it, otherwise as many whole
+// 64-byte packets as fit, and returns without waiting.
+//
+// When the ring is full the oldest complete frame is dropped (up to the
+// next 0x00 in binary telemetry, the next newline in text) and counted,
+// so a stalled host costs samples, never sampling.
+//
+// With USE_FREERTOS, write() and poll() take a mutex so several tasks can
+// print; hold() keeps other tasks' poll() off the port while one of them
+// writes to it directly.
+
+#define TELEMETRY_BUFFER_SIZE 1024
+#define TELEMETRY_USB_PACKET 64 // full-speed bulk packet size
+
+class TelemetryWriter : public Print
+{
+public:
+    void begin(Print &port);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    using Print::write;
+
+    // Hands as much buffered output to the port as it takes without blocking
+    void poll();
+
+    // Keeps polling until the ring is empty or timeoutMs passes. Used before
+    // output that bypasses the ring, such as console replies.
+    void drain(uint32_t timeoutMs);
+
+    // While held, only drain() sends; the holder owns the port
+    void hold(bool on) { held = on; }
+
+    size_t pending() const { return used; }
+    uint32_t dropped() const { return droppedFrames; }
+
+private:
+    void dropOldest();
+    void send();
+    void lock();
+    void unlock();
+
+    Print *port = nullptr;
+    uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+    uint16_t tail = 0; // oldest byte
+    uint16_t used = 0;
+    uint32_t droppedFrames = 0;
+    volatile bool held = false;
+#ifdef USE_FREERTOS
+    SemaphoreHandle_t mutex = nullptr;
+#endif
+};
+
+extern TelemetryWriter telemetryWriter;
+
+#endif // TELEMETRY_WRITER_H
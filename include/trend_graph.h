@@ -0,0 +1,30 @@
+#ifndef TREND_GRAPH_H
+#define TREND_GRAPH_H
+
+#include <Arduino.h>
+#include "history.h"
+#include "oled_image.h"
+
+// Full-screen strip chart of one history channel, newest value in the title.
+//
+// Each history sample is one plot column. New samples are drawn at a
+// sweep cursor that wraps at the right edge, with a blank column just
+// ahead of it marking where the newest point is. The SH1106 has no
+// hardware scroll, and shifting the plot in software would change every
+// column, so each sample would resend the whole plot area. The sweep
+// changes two columns, one byte per plot page each, so an update costs
+// about the same bus time as a changed digit on the sensor screen.
+//
+// The vertical scale follows the running min/max the history keeps for
+// its statistics, so choosing it never scans the ring. The plot is only
+// redrawn from the history when that range leaves the current scale or
+// shrinks to under half of it, when the channel changes, or when another
+// screen was drawn over the graph.
+
+#define TREND_COLUMNS OLED_WIDTH // one history sample per column
+
+// Brings the graph of channel up to date with the history.
+// Returns true if the framebuffer changed and needs a flush.
+bool trendGraphRender(HistoryChannel channel);
+
+#endif // TREND_GRAPH_H
@@ -0,0 +1,59 @@
+#ifndef UI_PAGES_H
+#define UI_PAGES_H
+
+#include <Arduino.h>
+#include "sensors.h"
+
+// Screen pages, stepped through with the double press.
+//
+// Each page registers a render function and the inputs it depends on.
+// Producers mark an input when it changes, which is a bit-OR into a
+// pending mask; pagesMark() answers whether the visible page depends on
+// it, so the producer only wakes the display task when that page cares.
+// pagesRender() draws the visible page alone, and only if one of its
+// inputs was marked since its last render or it has just come up, so a
+// hidden page costs nothing per sample however many pages there are.
+//
+// A page that has just come up (or was drawn over by a splash) renders
+// with full = true and must draw everything; otherwise it may touch only
+// what changed.
+
+#define PAGE_MAX 12
+#define PAGE_TICK_MS 1000 // PAGE_IN_TICK rate while such a page is visible
+
+// --- Inputs ---
+#define PAGE_IN_READING(sensor) (1u << (sensor)) // reading worth showing, or a failed read
+#define PAGE_IN_HISTORY (1u << SENSOR_MAX)       // history gained a sample
+#define PAGE_IN_SENSORS (1u << (SENSOR_MAX + 1)) // a sensor or bus went away or came back
+#define PAGE_IN_TICK (1u << (SENSOR_MAX + 2))    // PAGE_TICK_MS passed, for live counters
+
+// Draws the page for arg into the framebuffer; returns true if it changed
+typedef bool (*PageRender)(uint8_t arg, bool full);
+
+// Whether the page for arg is in the rotation right now
+typedef bool (*PageAvailable)(uint8_t arg);
+
+// Registers a page; the first one is shown at boot and must always be
+// available. Returns its id, or -1 if the table is full.
+int pagesAdd(const char *name, uint16_t inputs, PageRender render, uint8_t arg = 0,
+             PageAvailable available = nullptr);
+
+// Marks inputs as changed. Returns true if the visible page depends on one.
+bool pagesMark(uint16_t inputs);
+
+// True if the visible page depends on one of inputs
+bool pagesWants(uint16_t inputs);
+
+// Renders the visible page if it is due. Returns true if the framebuffer changed.
+bool pagesRender();
+
+// Steps to the next available page, wrapping to the first
+void pagesNext();
+
+// Something else drew over the screen; the next render is a full one
+void pagesInvalidate();
+
+const char *pagesName();
+uint8_t pagesArg();
+
+#endif // UI_PAGES_H
@@ -0,0 +1,81 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Minimal Arduino API for the native (host) build.
+//
+// Only what the portable modules use is provided. Time comes from a
+// simulated clock that the harness sets; every read also advances it by
+// one microsecond, so busy-wait loops in the firmware terminate.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 4
+#define DEC 10
+#define HEX 16
+
+#define F(s) (s)
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+static inline void noInterrupts() {}
+static inline void interrupts() {}
+static inline void pinMode(uint32_t, uint32_t) {}
+static inline void digitalWrite(uint32_t, uint32_t) {}
+static inline int digitalRead(uint32_t) { return HIGH; }
+
+// --- Simulated clock, driven by the harness ---
+void simSetMicros(uint32_t us);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t len);
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    virtual int availableForWrite() { return 0; }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(T v) { return print(v) + println(); }
+    template <typename T>
+    size_t println(T v, int fmt) { return print(v, fmt) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+#endif // SIM_ARDUINO_H
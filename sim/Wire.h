@@ -0,0 +1,78 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+// Simulated I2C bus for the native build. Transactions are routed to
+// SimI2cDevice models by address, and every device counts the traffic it
+// sees so the harness can report and gate on bus usage.
+
+#define SIM_WIRE_BUFFER 32 // same transmit/receive buffer as the STM32 core
+#define SIM_MAX_DEVICES 4
+
+struct SimBusCounts
+{
+    uint32_t transactions; // as the firmware counts them: a register read is one
+    uint32_t writes;       // write transfers (addressed, ACKed)
+    uint32_t reads;        // read transfers
+    uint32_t bytesWritten;
+    uint32_t bytesRead;
+    uint64_t bits;         // SCL cycles including start/address/ACK overhead
+};
+
+class SimI2cDevice
+{
+public:
+    explicit SimI2cDevice(uint8_t address) : addr(address), counts() {}
+    virtual ~SimI2cDevice() {}
+
+    // One complete write transaction (bytes after the address)
+    virtual void onWrite(const uint8_t *data, size_t len) = 0;
+    // Fills a read transaction; returns the bytes supplied
+    virtual size_t onRead(uint8_t *out, size_t len) = 0;
+
+    const uint8_t addr;
+    SimBusCounts counts;
+};
+
+class TwoWire : public Stream
+{
+public:
+    void begin() {}
+    void setClock(uint32_t hz) { clock = hz; }
+    uint32_t getClock() const { return clock; }
+
+    void attach(SimI2cDevice *dev);
+
+    void beginTransmission(uint8_t addr);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t addr, uint8_t len, uint8_t stop = 1);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    using Print::write;
+    // As in the cores, so that write(0x00) is not ambiguous
+    size_t write(int n) { return write((uint8_t)n); }
+    size_t write(unsigned int n) { return write((uint8_t)n); }
+    int available() override { return (int)(rxLen - rxPos); }
+    int read() override { return rxPos < rxLen ? rx[rxPos++] : -1; }
+    int peek() override { return rxPos < rxLen ? rx[rxPos] : -1; }
+
+private:
+    SimI2cDevice *find(uint8_t addr);
+
+    SimI2cDevice *devices[SIM_MAX_DEVICES] = {};
+    uint8_t deviceCount = 0;
+    uint32_t clock = 100000;
+    uint8_t txAddr = 0;
+    uint8_t tx[SIM_WIRE_BUFFER];
+    size_t txLen = 0;
+    bool txOverflow = false;
+    uint8_t rx[SIM_WIRE_BUFFER];
+    size_t rxLen = 0;
+    size_t rxPos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,170 @@
+#include <Arduino.h>
+#include <Wire.h>
+
+TwoWire Wire;
+
+static uint32_t nowUs = 0;
+
+void simSetMicros(uint32_t us)
+{
+    nowUs = us;
+}
+
+uint32_t micros()
+{
+    return nowUs++;
+}
+
+uint32_t millis()
+{
+    return micros() / 1000;
+}
+
+void delay(uint32_t ms)
+{
+    nowUs += ms * 1000;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    nowUs += us;
+}
+
+// --- Print ---
+
+size_t Print::write(const uint8_t *data, size_t len)
+{
+    size_t n = 0;
+    while (len--)
+    {
+        n += write(*data++);
+    }
+    return n;
+}
+
+size_t Print::print(long n, int base)
+{
+    if (n < 0 && base == DEC)
+    {
+        return print('-') + print((unsigned long)-n, base);
+    }
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    char buf[8 * sizeof(long) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    do
+    {
+        unsigned d = (unsigned)(n % (unsigned)base);
+        *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+        n /= (unsigned)base;
+    } while (n);
+    return write(p);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+// --- Simulated bus ---
+
+// Start + address byte + ACK, then 9 clocks per byte, then stop
+static uint64_t transactionBits(size_t len)
+{
+    return 1 + 9 + 9 * (uint64_t)len + 1;
+}
+
+void TwoWire::attach(SimI2cDevice *dev)
+{
+    if (deviceCount < SIM_MAX_DEVICES)
+    {
+        devices[deviceCount++] = dev;
+    }
+}
+
+SimI2cDevice *TwoWire::find(uint8_t addr)
+{
+    for (uint8_t i = 0; i < deviceCount; i++)
+    {
+        if (devices[i]->addr == addr)
+        {
+            return devices[i];
+        }
+    }
+    return nullptr;
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+    txAddr = addr;
+    txLen = 0;
+    txOverflow = false;
+}
+
+size_t TwoWire::write(uint8_t c)
+{
+    if (txLen >= sizeof(tx))
+    {
+        txOverflow = true;
+        return 0;
+    }
+    tx[txLen++] = c;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len)
+{
+    size_t n = 0;
+    while (n < len && write(data[n]))
+    {
+        n++;
+    }
+    return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+    SimI2cDevice *dev = find(txAddr);
+    if (!dev)
+    {
+        return 2; // address NACK
+    }
+    if (txOverflow)
+    {
+        return 1; // data too long for the buffer
+    }
+    dev->onWrite(tx, txLen);
+    dev->counts.transactions += stop ? 1 : 0; // else the read after the restart completes it
+    dev->counts.writes++;
+    dev->counts.bytesWritten += (uint32_t)txLen;
+    dev->counts.bits += transactionBits(txLen);
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t len, uint8_t stop)
+{
+    (void)stop;
+    rxLen = 0;
+    rxPos = 0;
+    SimI2cDevice *dev = find(addr);
+    if (!dev)
+    {
+        return 0;
+    }
+    if (len > sizeof(rx))
+    {
+        len = sizeof(rx);
+    }
+    rxLen = dev->onRead(rx, len);
+    dev->counts.transactions++;
+    dev->counts.reads++;
+    dev->counts.bytesRead += (uint32_t)rxLen;
+    dev->counts.bits += transactionBits(rxLen);
+    return (uint8_t)rxLen;
+}
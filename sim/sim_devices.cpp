@@ -0,0 +1,312 @@
+#include "sim_devices.h"
+#include "acquisition.h"
+#include "oled_transport.h"
+
+// --- BME280 ---
+
+#define BME280_REG_CHIPID 0xD0
+#define BME280_CHIPID 0x60
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+SimBme280::SimBme280(uint8_t address) : SimI2cDevice(address)
+{
+    memset(regs, 0, sizeof(regs));
+    regs[BME280_REG_CHIPID] = BME280_CHIPID;
+    // Trimming values of the datasheet's worked example (T, P) and a
+    // typical part (H)
+    const uint16_t tp[12] = {27504, 26435, (uint16_t)-1000, 36477, (uint16_t)-10685, 3024,
+                             2855, 140, (uint16_t)-7, 15500, (uint16_t)-14600, 6000};
+    for (uint8_t i = 0; i < 12; i++)
+    {
+        put16(&regs[BME280_REG_CALIB_TP + 2 * i], tp[i]);
+    }
+    regs[BME280_REG_CALIB_H1] = 75;
+    const int16_t h4 = 313;
+    const int16_t h5 = 50;
+    put16(&regs[BME280_REG_CALIB_H2], 362);
+    regs[BME280_REG_CALIB_H2 + 2] = 0;                                  // H3
+    regs[BME280_REG_CALIB_H2 + 3] = (uint8_t)(h4 >> 4);                 // 0xE4
+    regs[BME280_REG_CALIB_H2 + 4] = (uint8_t)((h4 & 0x0F) | ((h5 & 0x0F) << 4));
+    regs[BME280_REG_CALIB_H2 + 5] = (uint8_t)(h5 >> 4);                 // 0xE6
+    regs[BME280_REG_CALIB_H2 + 6] = 30;                                 // H6
+    // Skipped-measurement values until the first conversion
+    const uint8_t reset[8] = {0x80, 0x00, 0x00, 0x80, 0x00, 0x00, 0x80, 0x00};
+    memcpy(&regs[BME280_REG_DATA], reset, sizeof(reset));
+}
+
+void SimBme280::addFrame(const uint8_t frame[8])
+{
+    frames.emplace_back(frame, frame + 8);
+}
+
+size_t SimBme280::loadFrames(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        return 0;
+    }
+    size_t loaded = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f))
+    {
+        char *hash = strchr(line, '#');
+        if (hash)
+        {
+            *hash = '\0';
+        }
+        uint8_t frame[8];
+        size_t n = 0;
+        for (const char *p = line; *p && n < 8;)
+        {
+            unsigned v;
+            if (sscanf(p, "%2x", &v) != 1)
+            {
+                p++;
+                continue;
+            }
+            frame[n++] = (uint8_t)v;
+            p += 2;
+        }
+        if (n == 8)
+        {
+            addFrame(frame);
+            loaded++;
+        }
+    }
+    fclose(f);
+    return loaded;
+}
+
+void SimBme280::defaultFrames(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        // adc_T 519888 and adc_P 415148 are the datasheet example (25.08 C,
+        // 1006.53 hPa); the steps move the last displayed digit now and then
+        int32_t adcT = 519888 + (int32_t)(i % 40) * 40;
+        int32_t adcP = 415148 - (int32_t)(i % 25) * 16;
+        int32_t adcH = 28000 + (int32_t)(i % 30) * 8;
+        const uint8_t frame[8] = {
+            (uint8_t)(adcP >> 12), (uint8_t)(adcP >> 4), (uint8_t)(adcP << 4),
+            (uint8_t)(adcT >> 12), (uint8_t)(adcT >> 4), (uint8_t)(adcT << 4),
+            (uint8_t)(adcH >> 8), (uint8_t)adcH,
+        };
+        addFrame(frame);
+    }
+}
+
+static uint32_t oversampling(uint8_t code)
+{
+    return code ? (1u << (code - 1)) : 0; // 0 skip, 1 x1 ... 5 x16
+}
+
+uint32_t SimBme280::conversionUs() const
+{
+    uint8_t meas = regs[BME280_REG_CTRL_MEAS];
+    uint8_t osrsT = meas >> 5;
+    uint8_t osrsP = (meas >> 2) & 0x07;
+    uint8_t osrsH = regs[BME280_REG_CTRL_HUM] & 0x07;
+    // t_meas,typ = 1 + 2*T + (2*P + 0.5) + (2*H + 0.5) ms
+    return 1000 + 2000 * oversampling(osrsT) + (osrsP ? 2000 * oversampling(osrsP) + 500 : 0) +
+           (osrsH ? 2000 * oversampling(osrsH) + 500 : 0);
+}
+
+uint32_t SimBme280::standbyUs() const
+{
+    static const uint32_t standby[8] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+    return standby[regs[BME280_REG_CONFIG] >> 5];
+}
+
+void SimBme280::advance()
+{
+    if ((regs[BME280_REG_CTRL_MEAS] & 0x03) != BME280_MODE_NORMAL)
+    {
+        return;
+    }
+    uint32_t conv = conversionUs();
+    uint32_t cycle = conv + standbyUs();
+    uint32_t elapsed = micros() - normalStart;
+    uint32_t done = elapsed >= conv ? (elapsed - conv) / cycle + 1 : 0;
+    for (; normalDone < done; normalDone++)
+    {
+        convert();
+    }
+    normalMeasuring = elapsed % cycle < conv;
+}
+
+void SimBme280::convert()
+{
+    if (!frames.empty())
+    {
+        memcpy(&regs[BME280_REG_DATA], frames[nextFrame].data(), BME280_DATA_LEN);
+        nextFrame = (nextFrame + 1) % frames.size();
+    }
+    converted++;
+}
+
+void SimBme280::onWrite(const uint8_t *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    pointer = data[0];
+    // Writes are register/value pairs; a lone register byte sets the read pointer
+    for (size_t i = 0; i + 1 < len; i += 2)
+    {
+        uint8_t reg = data[i];
+        regs[reg] = data[i + 1];
+        if (reg == BME280_REG_CTRL_MEAS && (data[i + 1] & 0x03) == BME280_MODE_NORMAL)
+        {
+            normalStart = micros(); // the first cycle starts with a conversion
+            normalDone = 0;
+        }
+        if (reg == BME280_REG_CTRL_MEAS && (data[i + 1] & 0x03) == BME280_MODE_FORCED)
+        {
+            busyUntil = micros() + conversionUs();
+            convert();
+        }
+    }
+}
+
+size_t SimBme280::onRead(uint8_t *out, size_t len)
+{
+    advance();
+    if (pointer == BME280_REG_STATUS)
+    {
+        uint8_t mode = regs[BME280_REG_CTRL_MEAS] & 0x03;
+        bool measuring = false;
+        if (mode == BME280_MODE_FORCED)
+        {
+            measuring = (int32_t)(micros() - busyUntil) < 0;
+            if (!measuring)
+            {
+                regs[BME280_REG_CTRL_MEAS] &= (uint8_t)~0x03; // back to sleep
+            }
+        }
+        else if (mode == BME280_MODE_NORMAL)
+        {
+            measuring = normalMeasuring;
+        }
+        regs[BME280_REG_STATUS] = measuring ? BME280_STATUS_MEASURING : 0;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = regs[(uint8_t)(pointer + i)];
+    }
+    pointer = (uint8_t)(pointer + len);
+    return len;
+}
+
+// --- SH1106 ---
+
+#define SH1106_COLUMNS 132
+
+SimSh1106::SimSh1106(uint8_t address) : SimI2cDevice(address)
+{
+    // Power-up RAM content is undefined
+    for (size_t i = 0; i < sizeof(ram); i++)
+    {
+        ((uint8_t *)ram)[i] = (uint8_t)(i * 37);
+    }
+}
+
+bool SimSh1106::pixel(uint8_t x, uint8_t y) const
+{
+    return (ram[y / 8][x + OLED_COLUMN_OFFSET] >> (y % 8)) & 1;
+}
+
+void SimSh1106::show(FILE *out) const
+{
+    for (uint8_t y = 0; y < 64; y++)
+    {
+        for (uint8_t x = 0; x < 128; x++)
+        {
+            fputc(pixel(x, y) ? '#' : '.', out);
+        }
+        fputc('\n', out);
+    }
+}
+
+void SimSh1106::command(uint8_t c)
+{
+    if (argsPending)
+    {
+        argsPending--;
+        return;
+    }
+    switch (c)
+    {
+    case SH1106_DISPLAYOFF:
+        on = false;
+        return;
+    case SH1106_DISPLAYON:
+        on = true;
+        return;
+    case 0x81: case 0xA8: case 0xAD: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        argsPending = 1; // two-byte commands
+        return;
+    default:
+        break;
+    }
+    if ((c & 0xF0) == 0xB0)
+    {
+        page = c & 0x07;
+    }
+    else if ((c & 0xF0) == 0x00)
+    {
+        column = (uint8_t)((column & 0xF0) | (c & 0x0F));
+    }
+    else if ((c & 0xF0) == 0x10)
+    {
+        column = (uint8_t)((column & 0x0F) | ((c & 0x0F) << 4));
+    }
+}
+
+void SimSh1106::data(uint8_t d)
+{
+    if (column < SH1106_COLUMNS)
+    {
+        ram[page][column++] = d;
+    }
+    dataBytes++;
+}
+
+void SimSh1106::onWrite(const uint8_t *bytes, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        uint8_t control = bytes[i++];
+        bool continuation = control & 0x80; // Co: one byte, then another control byte
+        bool isData = control & 0x40;
+        if (continuation)
+        {
+            if (i < len)
+            {
+                isData ? data(bytes[i]) : command(bytes[i]);
+                i++;
+            }
+            continue;
+        }
+        for (; i < len; i++)
+        {
+            isData ? data(bytes[i]) : command(bytes[i]);
+        }
+    }
+}
+
+size_t SimSh1106::onRead(uint8_t *out, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = on ? 0x00 : 0x40; // status: bit 6 set while the display is off
+    }
+    return len;
+}
@@ -0,0 +1,79 @@
+#ifndef SIM_DEVICES_H
+#define SIM_DEVICES_H
+
+#include <Wire.h>
+#include <vector>
+
+// Register-level models of the two devices on the board's I2C bus.
+
+// BME280: calibration block, control registers and the data registers.
+// Each conversion (a forced trigger, or a normal-mode cycle) loads the
+// next raw frame of the replay list into 0xF7..0xFE, wrapping at the end.
+// Conversions take the datasheet's typical time. In normal mode they
+// repeat every t_measure + t_standby from the ctrl_meas write that
+// started it, and the measuring bit is set only during t_measure.
+class SimBme280 : public SimI2cDevice
+{
+public:
+    explicit SimBme280(uint8_t address);
+
+    // One frame is the 8 data registers exactly as read from a device
+    void addFrame(const uint8_t frame[8]);
+    // Text file, one frame per line as 16 hex digits; '#' starts a comment.
+    // Returns the number of frames loaded.
+    size_t loadFrames(const char *path);
+    // A slow drift around the datasheet's example conditions
+    void defaultFrames(size_t count);
+
+    size_t frameCount() const { return frames.size(); }
+    uint32_t conversions() const { return converted; }
+
+    void onWrite(const uint8_t *data, size_t len) override;
+    size_t onRead(uint8_t *out, size_t len) override;
+
+private:
+    void convert();
+    void advance(); // runs the normal-mode conversions due by micros()
+    uint32_t conversionUs() const;
+    uint32_t standbyUs() const;
+
+    uint8_t regs[256];
+    uint8_t pointer = 0;
+    std::vector<std::vector<uint8_t>> frames;
+    size_t nextFrame = 0;
+    uint32_t converted = 0;
+    uint32_t busyUntil = 0; // forced conversion end, micros()
+    uint32_t normalStart = 0;   // micros() of the switch to normal mode
+    uint32_t normalDone = 0;    // normal-mode conversions completed since
+    bool normalMeasuring = false;
+};
+
+// SH1106: command parser and the 132 x 64 display RAM
+class SimSh1106 : public SimI2cDevice
+{
+public:
+    explicit SimSh1106(uint8_t address);
+
+    bool displayOn() const { return on; }
+    uint32_t pixelBytes() const { return dataBytes; }
+    bool pixel(uint8_t x, uint8_t y) const; // visible coordinates
+
+    // Draws the visible area with '#' and '.'
+    void show(FILE *out) const;
+
+    void onWrite(const uint8_t *data, size_t len) override;
+    size_t onRead(uint8_t *out, size_t len) override;
+
+private:
+    void command(uint8_t c);
+    void data(uint8_t d);
+
+    uint8_t ram[8][132];
+    uint8_t page = 0;
+    uint8_t column = 0;
+    uint8_t argsPending = 0; // argument bytes of a two-byte command
+    bool on = false;
+    uint32_t dataBytes = 0;
+};
+
+#endif // SIM_DEVICES_H
@@ -0,0 +1,28 @@
+#ifndef SIM_GATES_H
+#define SIM_GATES_H
+
+// Bus and rate limits of the native build, shared by the harness in
+// sim_main.cpp and the pio test suite in test/test_native.
+
+// Gates, per delivered sample (sensor) or per screen update (panel).
+// Transactions are counted as the "i2c" health stats count them: a
+// register read (write, restart, read) is one, like a register write.
+#ifndef SIM_GATE_SENSOR_TRANSACTIONS
+#define SIM_GATE_SENSOR_TRANSACTIONS 4
+#endif
+#ifndef SIM_GATE_SENSOR_BYTES
+#define SIM_GATE_SENSOR_BYTES 16
+#endif
+// A normal-mode sample also pays about one data read that finds the frame unchanged
+#ifndef SIM_GATE_SENSOR_BYTES_NORMAL
+#define SIM_GATE_SENSOR_BYTES_NORMAL 24
+#endif
+#ifndef SIM_GATE_PANEL_BYTES
+#define SIM_GATE_PANEL_BYTES 64
+#endif
+// Share of the sensor's conversions that never became a sample, percent
+#ifndef SIM_GATE_MISSED_PERCENT
+#define SIM_GATE_MISSED_PERCENT 2
+#endif
+
+#endif // SIM_GATES_H
@@ -0,0 +1,255 @@
+// Native harness: runs the sample -> render -> flush -> telemetry path
+// against the simulated bus and reports the traffic per stage.
+//
+//   pio run -e native -t exec                            # defaults
+//   .pio/build/native/program --profile fast                 # normal mode
+//   .pio/build/native/program --frames capture.txt --samples 500 --show
+//   .pio/build/native/program --graph press --samples 1000   # history graph screen
+//
+// Exits with status 1 if a per-sample bus figure is above its gate, or
+// the sampler missed conversions the sensor made (run with --profile fast
+// as well, for the normal-mode path), so the run can act as a
+// performance regression check in CI.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+#include "sim_devices.h"
+#include "sim_gates.h"
+#include "i2c_bus.h"
+#include "sensors.h"
+#include "sampler.h"
+#include "oled_renderer.h"
+#include "history.h"
+#include "trend_graph.h"
+#include "telemetry.h"
+
+// pio test builds the sources with its own main (test/test_native)
+#ifndef PIO_UNIT_TESTING
+
+#define BME_ADDR 0x76
+#define OLED_ADDR 0x3C
+
+class StdoutPrint : public Print
+{
+public:
+    size_t write(uint8_t c) override
+    {
+        return fputc(c, stdout) == EOF ? 0 : 1;
+    }
+};
+
+class CountingPrint : public Print
+{
+public:
+    size_t write(uint8_t) override
+    {
+        bytes++;
+        return 1;
+    }
+    size_t write(const uint8_t *, size_t len) override
+    {
+        bytes += len;
+        writes++;
+        return len;
+    }
+    uint64_t bytes = 0;
+    uint64_t writes = 0;
+};
+
+static uint32_t busUs(const SimBusCounts &c)
+{
+    return (uint32_t)(c.bits * 1000000ULL / Wire.getClock());
+}
+
+static SimBusCounts since(const SimBusCounts &now, const SimBusCounts &then)
+{
+    SimBusCounts d;
+    d.transactions = now.transactions - then.transactions;
+    d.writes = now.writes - then.writes;
+    d.reads = now.reads - then.reads;
+    d.bytesWritten = now.bytesWritten - then.bytesWritten;
+    d.bytesRead = now.bytesRead - then.bytesRead;
+    d.bits = now.bits - then.bits;
+    return d;
+}
+
+static void report(const char *stage, const SimBusCounts &c, uint32_t per)
+{
+    per = per ? per : 1;
+    printf("%s,%u,%.2f,%.2f,%.2f,%.1f\n", stage, per, (double)c.transactions / per,
+           (double)c.bytesWritten / per, (double)c.bytesRead / per, (double)busUs(c) / per);
+}
+
+static bool gate(const char *name, double value, double limit)
+{
+    bool ok = value <= limit;
+    printf("gate %s %.2f <= %.0f %s\n", name, value, limit, ok ? "pass" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const char *framesPath = nullptr;
+    uint32_t samples = 200;
+    SamplingProfileId profile = PROFILE_WEATHER;
+    bool show = false;
+    int graph = -1; // history channel on screen instead of the readings
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            framesPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+        {
+            samples = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            profile = samplerFindProfile(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--binary") == 0)
+        {
+            telemetrySetFormat(TELEMETRY_BINARY);
+        }
+        else if (strcmp(argv[i], "--show") == 0)
+        {
+            show = true;
+        }
+        else if (strcmp(argv[i], "--graph") == 0 && i + 1 < argc)
+        {
+            static const char *const names[HIST_CHANNELS] = {"temp", "hum", "press"};
+            ++i;
+            for (int c = 0; c < HIST_CHANNELS; c++)
+            {
+                graph = strcmp(argv[i], names[c]) == 0 ? c : graph;
+            }
+            if (graph < 0)
+            {
+                fprintf(stderr, "graphs are temp, hum, press\n");
+                return 2;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--frames file] [--samples n] [--profile name] [--binary] [--show]"
+                    " [--graph temp|hum|press]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (profile == PROFILE_COUNT)
+    {
+        fprintf(stderr, "unknown profile\n");
+        return 2;
+    }
+
+    SimBme280 bme(BME_ADDR);
+    SimSh1106 panel(OLED_ADDR);
+    if (framesPath ? bme.loadFrames(framesPath) == 0 : (bme.defaultFrames(100), false))
+    {
+        fprintf(stderr, "no frames in %s\n", framesPath);
+        return 2;
+    }
+    Wire.attach(&bme);
+    Wire.attach(&panel);
+
+    // --- Boot, as in setup() ---
+    StdoutPrint log;
+    I2cBus bus;
+    I2cDevice devices[] = {
+        {"BME280", BME_ADDR, i2cProbeBme280, 0},
+        {"SH1106", OLED_ADDR, i2cProbeSh1106, 0},
+    };
+    i2cBusBegin(bus, &Wire);
+    i2cBusNegotiate(bus, devices, 2, log);
+    sensorsDiscover(&bus, 1);
+    samplerSetProfile(profile);
+    if (samplerStartSensors() == 0 || !oledRendererBegin(&Wire, OLED_ADDR))
+    {
+        fprintf(stderr, "device bring-up failed\n");
+        return 1;
+    }
+    const SimBusCounts bootBme = bme.counts;
+    const SimBusCounts bootPanel = panel.counts;
+    const uint32_t bootConversions = bme.conversions();
+    const uint32_t startUs = micros();
+
+    // --- Steady state ---
+    CountingPrint telemetry;
+    uint32_t delivered = 0;
+    uint32_t updates = 0;
+    uint32_t failures = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (delivered < samples)
+    {
+        uint32_t next = samplerNextPollUs();
+        if ((int32_t)(next - micros()) > 0)
+        {
+            simSetMicros(next);
+        }
+        uint8_t failed;
+        uint8_t fresh = samplerPoll(micros(), failed);
+        failures += failed ? 1 : 0;
+        if (!(fresh & 1))
+        {
+            continue;
+        }
+        const Sensor &s = sensorAt(0);
+        delivered++;
+        uint32_t before = panel.pixelBytes();
+        if (graph >= 0)
+        {
+            historyAdd(s.reading, s.readingMs, s.stamp.seconds);
+            if (trendGraphRender((HistoryChannel)graph))
+            {
+                oledRendererFlushWait();
+            }
+        }
+        else
+        {
+            oledRendererSensorScreen(s.reading);
+            oledRendererFlushWait();
+        }
+        updates += panel.pixelBytes() != before ? 1 : 0;
+        telemetryWriteSample(telemetry, s.reading, s.stamp, 0);
+    }
+    double hostUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    const uint32_t conversions = bme.conversions() - bootConversions;
+    const uint32_t simUs = micros() - startUs;
+
+    const SimBusCounts runBme = since(bme.counts, bootBme);
+    const SimBusCounts runPanel = since(panel.counts, bootPanel);
+    printf("\nbus clock %u kHz, profile %s, %u frames\n", i2cBusClock(bus) / 1000, samplingProfiles[profile].name,
+           (unsigned)bme.frameCount());
+    printf("stage,count,transactions,bytes_out,bytes_in,bus_us\n");
+    report("boot.bme280", bootBme, 1);
+    report("boot.sh1106", bootPanel, 1);
+    report("sample.bme280", runBme, delivered);
+    report("update.sh1106", runPanel, updates);
+    printf("telemetry,%u,%.2f bytes/sample,%.2f writes/sample\n", delivered, (double)telemetry.bytes / delivered,
+           (double)telemetry.writes / delivered);
+    printf("host,%u samples in %.0f us, %.2f us/sample\n", delivered, hostUs, hostUs / delivered);
+    printf("rate,%u samples of %u conversions in %.3f s, %.2f samples/s\n", delivered, (unsigned)conversions,
+           simUs / 1e6, simUs ? delivered * 1e6 / simUs : 0.0);
+    const SensorReading &r = sensorAt(0).reading;
+    printf("last reading: %.2f C, %.2f %%RH, %.2f mBar; %u failed polls\n\n", r.temperature / 100.0,
+           r.humidity / 1024.0, r.pressure / 25600.0, failures);
+
+    if (show)
+    {
+        panel.show(stdout);
+    }
+
+    bool ok = gate("sensor_transactions", (double)runBme.transactions / delivered,
+                   SIM_GATE_SENSOR_TRANSACTIONS);
+    ok = gate("sensor_bytes", (double)(runBme.bytesWritten + runBme.bytesRead) / delivered,
+              samplingProfiles[profile].config.mode == BME280_MODE_NORMAL ? SIM_GATE_SENSOR_BYTES_NORMAL
+                                                                           : SIM_GATE_SENSOR_BYTES) && ok;
+    ok = gate("panel_bytes", updates ? (double)(runPanel.bytesWritten) / updates : 0, SIM_GATE_PANEL_BYTES) && ok;
+    ok = gate("missed_conversions", conversions > delivered ? 100.0 * (conversions - delivered) / conversions : 0,
+              SIM_GATE_MISSED_PERCENT) && ok;
+    return ok ? 0 : 1;
+}
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,202 @@
+#include "acquisition.h"
+#include "i2c_bus.h"
+#include "profiler.h"
+
+// Little-endian helpers for the trimming parameter block
+static inline uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+bool BmeAcquisition::begin(uint8_t addr, TwoWire *wire)
+{
+    _wire = wire;
+    _addr = addr;
+
+    uint8_t tp[24];
+    uint8_t h1;
+    uint8_t h[7];
+    if (!readRegisters(BME280_REG_CALIB_TP, tp, sizeof(tp)) ||
+        !readRegisters(BME280_REG_CALIB_H1, &h1, 1) ||
+        !readRegisters(BME280_REG_CALIB_H2, h, sizeof(h)))
+    {
+        return false;
+    }
+
+    _calib.T1 = le16(&tp[0]);
+    _calib.T2 = (int16_t)le16(&tp[2]);
+    _calib.T3 = (int16_t)le16(&tp[4]);
+    _calib.P1 = le16(&tp[6]);
+    _calib.P2 = (int16_t)le16(&tp[8]);
+    _calib.P3 = (int16_t)le16(&tp[10]);
+    _calib.P4 = (int16_t)le16(&tp[12]);
+    _calib.P5 = (int16_t)le16(&tp[14]);
+    _calib.P6 = (int16_t)le16(&tp[16]);
+    _calib.P7 = (int16_t)le16(&tp[18]);
+    _calib.P8 = (int16_t)le16(&tp[20]);
+    _calib.P9 = (int16_t)le16(&tp[22]);
+    _calib.H1 = h1;
+    _calib.H2 = (int16_t)le16(&h[0]);
+    _calib.H3 = h[2];
+    // dig_H4/dig_H5 are 12-bit signed values sharing the nibbles of 0xE5
+    _calib.H4 = (int16_t)(((int8_t)h[3] * 16) | (h[4] & 0x0F));
+    _calib.H5 = (int16_t)(((int8_t)h[5] * 16) | (h[4] >> 4));
+    _calib.H6 = (int8_t)h[6];
+    return true;
+}
+
+bool BmeAcquisition::readFrame(BmeRawFrame &frame)
+{
+    uint8_t d[BME280_DATA_LEN];
+    if (!readRegisters(BME280_REG_DATA, d, sizeof(d)))
+    {
+        return false;
+    }
+    frame.adcP = ((int32_t)d[0] << 12) | ((int32_t)d[1] << 4) | (d[2] >> 4);
+    frame.adcT = ((int32_t)d[3] << 12) | ((int32_t)d[4] << 4) | (d[5] >> 4);
+    frame.adcH = ((int32_t)d[6] << 8) | d[7];
+    return true;
+}
+
+bool BmeAcquisition::compensate(const BmeRawFrame &frame, SensorReading &out) const
+{
+    // 0x80000 / 0x8000 are the reset values reported for skipped measurements
+    if (frame.adcT == 0x80000 || frame.adcP == 0x80000 || frame.adcH == 0x8000)
+    {
+        return false;
+    }
+
+    // --- Temperature (also yields t_fine for the other two) ---
+    int32_t adcT = frame.adcT;
+    int32_t var1 = ((((adcT >> 3) - ((int32_t)_calib.T1 << 1))) * ((int32_t)_calib.T2)) >> 11;
+    int32_t var2 = (((((adcT >> 4) - ((int32_t)_calib.T1)) * ((adcT >> 4) - ((int32_t)_calib.T1))) >> 12) *
+                    ((int32_t)_calib.T3)) >> 14;
+    int32_t tFine = var1 + var2;
+    int32_t centiC = (tFine * 5 + 128) >> 8;
+
+    // --- Pressure, 64-bit path, result in Q24.8 Pa ---
+    int64_t p1 = ((int64_t)tFine) - 128000;
+    int64_t p2 = p1 * p1 * (int64_t)_calib.P6;
+    p2 = p2 + ((p1 * (int64_t)_calib.P5) << 17);
+    p2 = p2 + (((int64_t)_calib.P4) << 35);
+    p1 = ((p1 * p1 * (int64_t)_calib.P3) >> 8) + ((p1 * (int64_t)_calib.P2) << 12);
+    p1 = ((((int64_t)1) << 47) + p1) * ((int64_t)_calib.P1) >> 33;
+    if (p1 == 0)
+    {
+        return false; // avoid division by zero on a bad calibration block
+    }
+    int64_t p = 1048576 - frame.adcP;
+    p = (((p << 31) - p2) * 3125) / p1;
+    p1 = (((int64_t)_calib.P9) * (p >> 13) * (p >> 13)) >> 25;
+    p2 = (((int64_t)_calib.P8) * p) >> 19;
+    p = ((p + p1 + p2) >> 8) + (((int64_t)_calib.P7) << 4);
+
+    // --- Humidity, result in Q22.10 %RH ---
+    int32_t h = tFine - ((int32_t)76800);
+    h = (((((frame.adcH << 14) - (((int32_t)_calib.H4) << 20) - (((int32_t)_calib.H5) * h)) + ((int32_t)16384)) >> 15) *
+         (((((((h * ((int32_t)_calib.H6)) >> 10) * (((h * ((int32_t)_calib.H3)) >> 11) + ((int32_t)32768))) >> 10) +
+            ((int32_t)2097152)) * ((int32_t)_calib.H2) + 8192) >> 14));
+    h = (h - (((((h >> 15) * (h >> 15)) >> 7) * ((int32_t)_calib.H1)) >> 4));
+    h = (h < 0 ? 0 : h);
+    h = (h > 419430400 ? 419430400 : h);
+
+    out.temperature = centiC;
+    out.pressure = (uint32_t)p;
+    out.humidity = (uint32_t)(h >> 12);
+    return true;
+}
+
+bool BmeAcquisition::read(SensorReading &out)
+{
+    BmeRawFrame frame;
+    uint32_t t = profilerStart();
+    if (!readFrame(frame))
+    {
+        return false;
+    }
+    profilerStop(PROF_SENSOR_READ, t);
+    t = profilerStart();
+    bool ok = compensate(frame, out);
+    profilerStop(PROF_COMPENSATE, t);
+    return ok;
+}
+
+bool BmeAcquisition::configure(const BmeConfig &config)
+{
+    uint8_t ctrlMeas = (uint8_t)((config.osrsT << 5) | (config.osrsP << 2));
+    if (!i2cWriteRegister(_wire, _addr, BME280_REG_CTRL_MEAS, ctrlMeas | BME280_MODE_SLEEP) ||
+        !i2cWriteRegister(_wire, _addr, BME280_REG_CONFIG, (uint8_t)((config.standby << 5) | (config.filter << 2))) ||
+        // ctrl_hum only takes effect after the following ctrl_meas write
+        !i2cWriteRegister(_wire, _addr, BME280_REG_CTRL_HUM, config.osrsH) ||
+        !i2cWriteRegister(_wire, _addr, BME280_REG_CTRL_MEAS, ctrlMeas | config.mode))
+    {
+        return false;
+    }
+    _config = config;
+    return true;
+}
+
+bool BmeAcquisition::startForced()
+{
+    uint8_t ctrlMeas = (uint8_t)((_config.osrsT << 5) | (_config.osrsP << 2) | BME280_MODE_FORCED);
+    return i2cWriteRegister(_wire, _addr, BME280_REG_CTRL_MEAS, ctrlMeas);
+}
+
+bool BmeAcquisition::sleep()
+{
+    uint8_t ctrlMeas = (uint8_t)((_config.osrsT << 5) | (_config.osrsP << 2) | BME280_MODE_SLEEP);
+    return i2cWriteRegister(_wire, _addr, BME280_REG_CTRL_MEAS, ctrlMeas);
+}
+
+bool BmeAcquisition::readStatus(uint8_t &status)
+{
+    return readRegisters(BME280_REG_STATUS, &status, 1);
+}
+
+// Oversampling code -> number of conversions (0 = skipped)
+static uint32_t oversampling(uint8_t code)
+{
+    return code == 0 ? 0 : (1UL << (code > 5 ? 4 : code - 1));
+}
+
+uint32_t BmeAcquisition::measurementTimeUs() const
+{
+    // t_meas,max = 1.25 + 2.3*T + (2.3*P + 0.575) + (2.3*H + 0.575) ms
+    uint32_t t = 1250 + 2300 * oversampling(_config.osrsT);
+    if (_config.osrsP)
+    {
+        t += 2300 * oversampling(_config.osrsP) + 575;
+    }
+    if (_config.osrsH)
+    {
+        t += 2300 * oversampling(_config.osrsH) + 575;
+    }
+    return t;
+}
+
+uint32_t BmeAcquisition::typicalMeasurementTimeUs() const
+{
+    // t_meas,typ = 1 + 2*T + (2*P + 0.5) + (2*H + 0.5) ms
+    uint32_t t = 1000 + 2000 * oversampling(_config.osrsT);
+    if (_config.osrsP)
+    {
+        t += 2000 * oversampling(_config.osrsP) + 500;
+    }
+    if (_config.osrsH)
+    {
+        t += 2000 * oversampling(_config.osrsH) + 500;
+    }
+    return t;
+}
+
+uint32_t BmeAcquisition::standbyTimeUs() const
+{
+    // t_sb codes 0..7
+    static const uint32_t standby[8] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+    return standby[_config.standby & 0x07];
+}
+
+bool BmeAcquisition::readRegisters(uint8_t reg, uint8_t *buf, uint8_t len)
+{
+    return i2cReadRegisters(_wire, _addr, reg, buf, len);
+}
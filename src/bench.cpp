@@ -0,0 +1,90 @@
+#include "bench.h"
+#include "profiler.h"
+#include "sensors.h"
+#include "sampler.h"
+#include "oled_renderer.h"
+#include "oled_transport.h"
+#include "telemetry.h"
+
+struct BenchBudget
+{
+    ProfileSection section;
+    uint32_t budgetUs;
+};
+
+static const BenchBudget budgets[] = {
+    {PROF_SENSOR_READ, BENCH_BUDGET_SENSOR_READ_US},
+    {PROF_COMPENSATE, BENCH_BUDGET_COMPENSATE_US},
+    {PROF_RENDER, BENCH_BUDGET_RENDER_US},
+    {PROF_TELEMETRY, BENCH_BUDGET_TELEMETRY_US},
+};
+
+// Counts and discards output, so formatting is timed without the port
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t len) override { return len; }
+};
+
+bool benchRun(Print &out, uint16_t runs)
+{
+    profilerReset();
+    samplerPause(true); // The bench reads the sensor itself
+    Sensor *sensor = (sensorCount() > 0 && sensorAt(0).ready) ? &sensorAt(0) : nullptr;
+    SensorReading base = {2150, 45u << 10, 101325u << 8}; // 21.5 C, 45 %RH, 1013.25 mBar
+    if (sensor && sensor->valid)
+    {
+        base = sensor->reading;
+    }
+    NullPrint sink;
+    for (uint16_t i = 0; i < runs; i++)
+    {
+        if (sensor)
+        {
+            SensorReading r;
+            oledTransportWaitIdle(); // The panel and the sensors share the bus
+            sensor->bme.read(r);     // Profiled inside: read and compensation
+        }
+        // Alternate the values so every field is redrawn
+        SensorReading v = base;
+        if (i & 1)
+        {
+            v.temperature += 111;
+            v.humidity += 11u << 10;
+            v.pressure += 1111u << 8;
+        }
+        uint32_t t = profilerStart();
+        oledRendererSensorScreen(v);
+        profilerStop(PROF_RENDER, t);
+        t = profilerStart();
+        SampleStamp stamp = {i, millis() / 1000, 0};
+        telemetryWriteSample(sink, v, stamp, 0);
+        profilerStop(PROF_TELEMETRY, t);
+    }
+    samplerPause(false);
+    // The next display refresh overwrites the benchmark values with the diff
+
+    profilerReport(out);
+    bool pass = true;
+    for (const BenchBudget &b : budgets)
+    {
+        const ProfileStats &s = profilerStats(b.section);
+        out.print(F("bench "));
+        out.print(profilerName(b.section));
+        if (s.count == 0)
+        {
+            out.println(F(" skipped"));
+            continue;
+        }
+        uint32_t mean = profilerCyclesToUs(s.totalCycles / s.count);
+        bool ok = mean <= b.budgetUs;
+        pass = pass && ok;
+        out.print(F(" mean "));
+        out.print(mean);
+        out.print(F(" us budget "));
+        out.print(b.budgetUs);
+        out.println(ok ? F(" us pass") : F(" us FAIL"));
+    }
+    return pass;
+}
@@ -0,0 +1,152 @@
+#include "button.h"
+#include "spsc_queue.h"
+
+static uint32_t buttonPin = 0;
+static void (*onEvent)(void) = nullptr;
+
+// Written by the tick only (producer); read by buttonPoll() (consumer)
+static SpscQueue<uint8_t, BUTTON_QUEUE_SIZE> queue;
+
+static volatile uint32_t lastEdgeMs = 0;
+static volatile uint8_t debounceMs = BUTTON_DEBOUNCE_MS;
+static volatile bool ticking = false;
+
+// Gesture state, only touched from the tick
+static bool pressed = false;      // debounced level
+static uint32_t pressedAtMs = 0;
+static uint32_t releasedAtMs = 0;
+static bool longSent = false;
+static bool shortPending = false; // released, waiting to see if a second press follows
+static bool secondPress = false;
+
+#if defined(ARDUINO_ARCH_STM32)
+#include <new>
+// Constructed in buttonBegin(), after the HAL is up, but without the heap
+alignas(HardwareTimer) static uint8_t timerStorage[sizeof(HardwareTimer)];
+static HardwareTimer *timer = nullptr;
+#endif
+
+static void push(ButtonEvent event)
+{
+    if (!queue.push((uint8_t)event))
+    {
+        return; // full: the consumer is far behind, drop the newest
+    }
+    if (onEvent)
+    {
+        onEvent();
+    }
+}
+
+static void stopTicking()
+{
+#if defined(ARDUINO_ARCH_STM32)
+    timer->pause();
+#endif
+    ticking = false;
+}
+
+void buttonBegin(uint32_t pin, void (*notify)(void))
+{
+    buttonPin = pin;
+    onEvent = notify;
+    pinMode(pin, INPUT_PULLUP);
+#if defined(ARDUINO_ARCH_STM32)
+    timer = new (timerStorage) HardwareTimer(BUTTON_TIMER);
+    timer->setOverflow(1000, HERTZ_FORMAT);
+    timer->attachInterrupt(buttonTick);
+#endif
+}
+
+void buttonEdgeInterrupt()
+{
+    lastEdgeMs = millis();
+    if (!ticking)
+    {
+        ticking = true;
+#if defined(ARDUINO_ARCH_STM32)
+        timer->resume();
+#endif
+    }
+}
+
+void buttonTick()
+{
+    uint32_t now = millis();
+    uint32_t edge = lastEdgeMs;
+    bool level = digitalRead(buttonPin) == LOW;
+    bool quiet = (now - edge) >= debounceMs;
+
+    if (quiet && level != pressed)
+    {
+        // The level has settled; the last edge is when it really changed
+        pressed = level;
+        if (pressed)
+        {
+            pressedAtMs = edge;
+            longSent = false;
+            secondPress = shortPending && (edge - releasedAtMs) <= BUTTON_DOUBLE_MS;
+            shortPending = false;
+        }
+        else if (!longSent)
+        {
+            if (secondPress)
+            {
+                push(BUTTON_DOUBLE);
+            }
+            else
+            {
+                shortPending = true;
+                releasedAtMs = edge;
+            }
+        }
+    }
+
+    if (pressed && !longSent && !secondPress && (now - pressedAtMs) >= BUTTON_LONG_MS)
+    {
+        longSent = true;
+        push(BUTTON_LONG);
+    }
+    if (!pressed && shortPending && (now - releasedAtMs) > BUTTON_DOUBLE_MS)
+    {
+        shortPending = false;
+        push(BUTTON_SHORT);
+    }
+
+    if (quiet && !pressed && !shortPending && level == pressed)
+    {
+        // An edge arriving right now must not be left without a timer
+        noInterrupts();
+        if (lastEdgeMs == edge)
+        {
+            stopTicking();
+        }
+        interrupts();
+    }
+}
+
+bool buttonPoll(ButtonEvent &event)
+{
+    uint8_t e;
+    if (!queue.pop(e))
+    {
+        return false;
+    }
+    event = (ButtonEvent)e;
+    return true;
+}
+
+bool buttonBusy()
+{
+    return ticking;
+}
+
+void buttonSetDebounceMs(uint8_t ms)
+{
+    debounceMs = ms;
+}
+
+uint8_t buttonDebounceMs()
+{
+    return debounceMs;
+}
@@ -0,0 +1,691 @@
+#include "console.h"
+#include "sampler.h"
+#include "settings.h"
+#include "telemetry.h"
+#include "telemetry_writer.h"
+#include "history.h"
+#include "logger.h"
+#include "fixed_format.h"
+#include "profiler.h"
+#include "bench.h"
+#include "button.h"
+#include "sensors.h"
+#include "filter.h"
+#include "rtc_time.h"
+#include "heap_guard.h"
+#include "derived.h"
+
+typedef void (*CommandHandler)(Print &out, uint8_t argc, char **argv);
+
+struct Command
+{
+    const char *name;
+    const char *usage;
+    CommandHandler handler;
+};
+
+static char line[CONSOLE_LINE_MAX];
+static uint8_t lineLen = 0;
+static bool overflow = false;
+
+static void cmdHelp(Print &out, uint8_t argc, char **argv);
+
+static void cmdProfile(Print &out, uint8_t argc, char **argv)
+{
+    if (argc < 2)
+    {
+        out.print(F("profile "));
+        out.println(samplingProfiles[samplerProfile()].name);
+        return;
+    }
+    SamplingProfileId id = samplerFindProfile(argv[1]);
+    if (id == PROFILE_COUNT)
+    {
+        out.println(F("error: profiles are weather, hvac, fast"));
+        return;
+    }
+    if (!samplerSetProfile(id))
+    {
+        out.println(F("error: sensor did not accept the configuration"));
+        return;
+    }
+    settings.profile = id;
+    settingsMarkDirty();
+    out.print(F("ok profile "));
+    out.println(samplingProfiles[id].name);
+}
+
+static void cmdFormat(Print &out, uint8_t argc, char **argv)
+{
+    if (argc < 2)
+    {
+        out.print(F("format "));
+        out.print(telemetryFormat() == TELEMETRY_BINARY ? "binary" : "text");
+        out.print(F(" dropped "));
+        out.println(telemetryWriter.dropped());
+        return;
+    }
+    TelemetryFormat f;
+    if (strcmp(argv[1], "text") == 0)
+    {
+        f = TELEMETRY_TEXT;
+    }
+    else if (strcmp(argv[1], "binary") == 0)
+    {
+        f = TELEMETRY_BINARY;
+    }
+    else
+    {
+        out.println(F("error: formats are text, binary"));
+        return;
+    }
+    telemetrySetFormat(f);
+    settings.telemetryFormat = f;
+    settingsMarkDirty();
+    out.print(F("ok format "));
+    out.println(argv[1]);
+}
+
+static const char *const channelNames[HIST_CHANNELS] = {"temp_c", "hum_pct", "press_pa"};
+static const uint8_t channelDecimals[HIST_CHANNELS] = {2, 2, 0};
+
+static void cmdStats(Print &out, uint8_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    out.print(F("samples "));
+    out.println(historyCount());
+    for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+    {
+        HistoryStats st = historyStats((HistoryChannel)c);
+        out.print(channelNames[c]);
+        out.print(F(" min "));
+        printFixed(out, st.min, channelDecimals[c]);
+        out.print(F(" max "));
+        printFixed(out, st.max, channelDecimals[c]);
+        out.print(F(" mean "));
+        printFixed(out, st.mean, channelDecimals[c]);
+        out.print(F(" n "));
+        out.println(st.count);
+    }
+    static const char *const outputNames[FILTER_OUTPUTS] = {"telemetry", "display", "log"};
+    out.print(F("reported"));
+    for (uint8_t o = 0; o < FILTER_OUTPUTS; o++)
+    {
+        FilterCounts fc = filterCounts((FilterOutput)o);
+        out.print(' ');
+        out.print(outputNames[o]);
+        out.print(' ');
+        out.print(fc.reported);
+        out.print('/');
+        out.print(fc.offered);
+    }
+    out.println();
+    int32_t trend;
+    out.print(F("trend_pa_3h "));
+    if (historyPressureTrend(trend))
+    {
+        out.println(trend);
+    }
+    else
+    {
+        out.println(F("n/a"));
+    }
+}
+
+static void cmdI2c(Print &out, uint8_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    for (uint8_t b = 0; b < i2cBusCount(); b++)
+    {
+        const I2cBus &bus = i2cBusAt(b);
+        out.print(F("bus "));
+        out.print(b + 1);
+        out.print(' ');
+        out.print(i2cBusClock(bus) / 1000);
+        out.print(F(" kHz "));
+        out.print(bus.faulted ? F("faulted") : F("ok"));
+        out.print(F(" xfer "));
+        out.print(bus.health.transactions);
+        out.print(F(" nack "));
+        out.print(bus.health.nacks);
+        out.print(F(" timeout "));
+        out.print(bus.health.timeouts);
+        out.print(F(" error "));
+        out.print(bus.health.errors);
+        out.print(F(" recover "));
+        out.println(bus.health.recoveries);
+    }
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        const Sensor &s = sensorAt(i);
+        char tag[SENSOR_LABEL_LEN];
+        sensorLabel(i, tag, sizeof(tag));
+        out.print(F("sensor "));
+        out.print(tag);
+        if (s.ready)
+        {
+            out.println(F(" online"));
+            continue;
+        }
+        out.print(F(" offline, retry in "));
+        out.print(s.backoffMs);
+        out.println(F(" ms"));
+    }
+}
+
+static void cmdMem(Print &out, uint8_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    HeapGuardStats st = heapGuardStats();
+    out.print(F("static "));
+    out.print(st.staticBytes);
+    out.print(F(" heap "));
+    out.print(st.heapBytes);
+    out.print(F(" locked "));
+    out.print(st.lockedBytes);
+    out.print(F(" refused "));
+    out.print(st.refused);
+    out.print(F(" free "));
+    out.print(st.freeBytes);
+    out.println(heapGuardGrown() ? F(" GROWN") : F(""));
+}
+
+static void cmdTime(Print &out, uint8_t argc, char **argv)
+{
+    if (argc > 1)
+    {
+        char *end = nullptr;
+        uint32_t t = strtoul(argv[1], &end, 10);
+        if (end == argv[1] || *end != '\0')
+        {
+            out.println(F("error: time [unix seconds]"));
+            return;
+        }
+        rtcTimeSet(t);
+        out.print(F("ok "));
+    }
+    RtcTime now;
+    rtcTimeNow(now);
+    out.print(F("time "));
+    out.print(now.seconds);
+    char fraction[8];
+    snprintf(fraction, sizeof(fraction), ".%06lu", (unsigned long)now.micros);
+    out.print(fraction);
+    out.println(rtcTimeIsSet() ? F("") : F(" unset"));
+}
+
+static void cmdHistory(Print &out, uint8_t argc, char **argv)
+{
+    uint16_t n = argc > 1 ? (uint16_t)atoi(argv[1]) : 10;
+    uint8_t derived = derivedOutputs(FILTER_OUT_LOG); // extra columns, computed per row
+    out.print(F("age,time_s,temp_c,hum_pct,press_pa"));
+    for (uint8_t m = 0; m < DERIVED_METRICS; m++)
+    {
+        if (derived & DERIVED_BIT(m))
+        {
+            out.print(',');
+            out.print(derivedInfo((DerivedMetric)m).column);
+        }
+    }
+    out.println();
+    HistorySample s;
+    uint32_t t;
+    for (uint16_t age = 0; age < n && historyGet(age, s) && historyTime(age, t); age++)
+    {
+        out.print(age);
+        out.print(',');
+        out.print(t);
+        for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+        {
+            out.print(',');
+            printFixed(out, historyValue(s, (HistoryChannel)c), channelDecimals[c]);
+        }
+        if (derived)
+        {
+            DerivedInputs in = {historyValue(s, HIST_TEMPERATURE), (uint32_t)historyValue(s, HIST_HUMIDITY),
+                                (uint32_t)historyValue(s, HIST_PRESSURE)};
+            DerivedValues v;
+            derivedCompute(in, derived, v);
+            for (uint8_t m = 0; m < DERIVED_METRICS; m++)
+            {
+                if (derived & DERIVED_BIT(m))
+                {
+                    out.print(',');
+                    printFixed(out, v.value[m], 2);
+                }
+            }
+        }
+        out.println();
+    }
+}
+
+static void cmdLog(Print &out, uint8_t argc, char **argv)
+{
+    if (argc < 2)
+    {
+        uint32_t oldest, newest;
+        out.print(F("log records "));
+        out.print(loggerCount());
+        out.print(F(" now "));
+        out.print(loggerNow());
+        if (loggerSpan(oldest, newest))
+        {
+            out.print(F(" oldest "));
+            out.print(oldest);
+            out.print(F(" newest "));
+            out.print(newest);
+        }
+        out.println();
+        return;
+    }
+    if (strcmp(argv[1], "dump") == 0)
+    {
+        uint32_t since = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+        out.write((uint8_t)0x00); // the first frame must not merge with earlier text
+        uint32_t n = loggerDump(out, since);
+        out.print(F("ok dumped "));
+        out.println(n);
+    }
+    else if (strcmp(argv[1], "flush") == 0)
+    {
+        loggerFlush();
+        out.println(F("ok flush"));
+    }
+    else if (strcmp(argv[1], "erase") == 0)
+    {
+        loggerErase();
+        out.println(F("ok erase"));
+    }
+    else
+    {
+        out.println(F("error: log [dump [since]|flush|erase]"));
+    }
+}
+
+static void cmdProf(Print &out, uint8_t argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "reset") == 0)
+    {
+        profilerReset();
+        out.println(F("ok prof reset"));
+        return;
+    }
+    profilerReport(out);
+}
+
+static void cmdBench(Print &out, uint8_t argc, char **argv)
+{
+    uint16_t runs = argc > 1 ? (uint16_t)atoi(argv[1]) : BENCH_DEFAULT_RUNS;
+    out.println(benchRun(out, runs ? runs : 1) ? F("ok bench pass") : F("error: bench over budget"));
+}
+
+// --- Tunable parameters for get/set ---
+
+struct Parameter
+{
+    const char *name;
+    uint8_t decimals; // the value is fixed-point in units of 10^-decimals
+    int32_t minValue;
+    int32_t maxValue;
+    int32_t (*get)();
+    void (*set)(int32_t value); // nullptr for read-only values
+};
+
+static int32_t getPeriod()
+{
+    return samplerPeriodMs();
+}
+
+static void setPeriod(int32_t v)
+{
+    settings.periodMs = (uint16_t)v;
+    samplerSetPeriodMs(settings.periodMs);
+}
+
+static int32_t getDebounce()
+{
+    return buttonDebounceMs();
+}
+
+static void setDebounce(int32_t v)
+{
+    settings.debounceMs = (uint8_t)v;
+    buttonSetDebounceMs(settings.debounceMs);
+}
+
+// Derived-metric parameters edit the stored configuration and re-apply
+// it, which drops the cached values
+static int32_t getQnh()
+{
+    return (int32_t)settings.derived.qnhPa;
+}
+
+static void setQnh(int32_t v)
+{
+    settings.derived.qnhPa = (uint32_t)v;
+    derivedSetConfig(settings.derived);
+}
+
+static int32_t getElevation()
+{
+    return settings.derived.elevationM;
+}
+
+static void setElevation(int32_t v)
+{
+    settings.derived.elevationM = (int16_t)v;
+    derivedSetConfig(settings.derived);
+}
+
+static int32_t getDerivedTelemetry()
+{
+    return settings.derived.outputs[FILTER_OUT_TELEMETRY];
+}
+
+static void setDerivedTelemetry(int32_t v)
+{
+    settings.derived.outputs[FILTER_OUT_TELEMETRY] = (uint8_t)v;
+    derivedSetConfig(settings.derived);
+}
+
+static int32_t getDerivedDisplay()
+{
+    return settings.derived.outputs[FILTER_OUT_DISPLAY];
+}
+
+static void setDerivedDisplay(int32_t v)
+{
+    settings.derived.outputs[FILTER_OUT_DISPLAY] = (uint8_t)v;
+    derivedSetConfig(settings.derived);
+}
+
+static int32_t getDerivedLog()
+{
+    return settings.derived.outputs[FILTER_OUT_LOG];
+}
+
+static void setDerivedLog(int32_t v)
+{
+    settings.derived.outputs[FILTER_OUT_LOG] = (uint8_t)v;
+    derivedSetConfig(settings.derived);
+}
+
+// Filter parameters edit the stored configuration and re-apply it, which
+// restarts the filters
+static int32_t getFilterMode()
+{
+    return settings.filter.mode;
+}
+
+static void setFilterMode(int32_t v)
+{
+    settings.filter.mode = (uint8_t)v;
+    filterSetConfig(settings.filter);
+}
+
+static int32_t getEmaShift()
+{
+    return settings.filter.emaShift;
+}
+
+static void setEmaShift(int32_t v)
+{
+    settings.filter.emaShift = (uint8_t)v;
+    filterSetConfig(settings.filter);
+}
+
+static int32_t getDeadbandTemp()
+{
+    return settings.filter.deadband[FILTER_TEMPERATURE];
+}
+
+static void setDeadbandTemp(int32_t v)
+{
+    settings.filter.deadband[FILTER_TEMPERATURE] = (uint16_t)v;
+    filterSetConfig(settings.filter);
+}
+
+static int32_t getDeadbandHum()
+{
+    return settings.filter.deadband[FILTER_HUMIDITY];
+}
+
+static void setDeadbandHum(int32_t v)
+{
+    settings.filter.deadband[FILTER_HUMIDITY] = (uint16_t)v;
+    filterSetConfig(settings.filter);
+}
+
+static int32_t getDeadbandPress()
+{
+    return settings.filter.deadband[FILTER_PRESSURE];
+}
+
+static void setDeadbandPress(int32_t v)
+{
+    settings.filter.deadband[FILTER_PRESSURE] = (uint16_t)v;
+    filterSetConfig(settings.filter);
+}
+
+static int32_t getHeartbeat()
+{
+    return settings.filter.heartbeatS;
+}
+
+static void setHeartbeat(int32_t v)
+{
+    settings.filter.heartbeatS = (uint16_t)v;
+    filterSetConfig(settings.filter);
+}
+
+static int32_t getRtcPpm()
+{
+    return settings.rtcPpm;
+}
+
+static void setRtcPpm(int32_t v)
+{
+    settings.rtcPpm = (int16_t)v;
+    rtcTimeSetCalibration(settings.rtcPpm);
+}
+
+// Barometric altitude of the primary sensor against qnh_pa, in cm
+static int32_t getAltitude()
+{
+    if (sensorCount() == 0 || !sensorAt(0).valid)
+    {
+        return 0;
+    }
+    DerivedValues v;
+    derivedCompute(derivedInputs(sensorAt(0).reading), DERIVED_BIT(DERIVED_ALTITUDE), v);
+    return v.value[DERIVED_ALTITUDE];
+}
+
+static const Parameter parameters[] = {
+    {"period_ms", 0, 0, SETTINGS_PERIOD_MS_MAX, getPeriod, setPeriod}, // 0 restores the profile's period
+    {"debounce_ms", 0, SETTINGS_DEBOUNCE_MS_MIN, SETTINGS_DEBOUNCE_MS_MAX, getDebounce, setDebounce},
+    {"qnh_pa", 0, SETTINGS_QNH_PA_MIN, SETTINGS_QNH_PA_MAX, getQnh, setQnh},
+    {"filter", 0, 0, FILTER_MODES - 1, getFilterMode, setFilterMode}, // none, median, ema, median+ema
+    {"ema_shift", 0, 1, FILTER_EMA_SHIFT_MAX, getEmaShift, setEmaShift}, // alpha = 1/2^n
+    {"deadband_cc", 0, 0, SETTINGS_DEADBAND_MAX, getDeadbandTemp, setDeadbandTemp},      // centi-degC
+    {"deadband_crh", 0, 0, SETTINGS_DEADBAND_MAX, getDeadbandHum, setDeadbandHum},       // centi-%RH
+    {"deadband_pa", 0, 0, SETTINGS_DEADBAND_MAX, getDeadbandPress, setDeadbandPress},
+    {"report_s", 0, 0, SETTINGS_REPORT_S_MAX, getHeartbeat, setHeartbeat}, // longest silence, 0 = every sample
+    {"rtc_ppm", 0, -RTC_CALIBRATION_MAX_PPM, RTC_CALIBRATION_MAX_PPM, getRtcPpm, setRtcPpm}, // + slows the RTC
+    {"elevation_m", 0, SETTINGS_ELEVATION_M_MIN, SETTINGS_ELEVATION_M_MAX, getElevation, setElevation}, // station height for sea-level pressure
+    {"derived_tel", 0, 0, DERIVED_ALL, getDerivedTelemetry, setDerivedTelemetry}, // bits: dew, abs hum, heat idx,
+    {"derived_disp", 0, 0, DERIVED_ALL, getDerivedDisplay, setDerivedDisplay},    // sea level, altitude
+    {"derived_log", 0, 0, DERIVED_ALL, getDerivedLog, setDerivedLog},             // columns of "history"
+    {"altitude_m", 2, 0, 0, getAltitude, nullptr},
+};
+static const uint8_t parameterCount = sizeof(parameters) / sizeof(parameters[0]);
+
+static void printParameter(Print &out, const Parameter &p)
+{
+    out.print(p.name);
+    out.print(' ');
+    printFixed(out, p.get(), p.decimals);
+    out.println();
+}
+
+static const Parameter *findParameter(const char *name)
+{
+    for (uint8_t i = 0; i < parameterCount; i++)
+    {
+        if (strcmp(name, parameters[i].name) == 0)
+        {
+            return &parameters[i];
+        }
+    }
+    return nullptr;
+}
+
+static void cmdGet(Print &out, uint8_t argc, char **argv)
+{
+    if (argc < 2)
+    {
+        for (uint8_t i = 0; i < parameterCount; i++)
+        {
+            printParameter(out, parameters[i]);
+        }
+        return;
+    }
+    const Parameter *p = findParameter(argv[1]);
+    if (!p)
+    {
+        out.print(F("error: unknown parameter "));
+        out.println(argv[1]);
+        return;
+    }
+    printParameter(out, *p);
+}
+
+static void cmdSet(Print &out, uint8_t argc, char **argv)
+{
+    if (argc < 3)
+    {
+        out.println(F("error: set <name> <value>"));
+        return;
+    }
+    const Parameter *p = findParameter(argv[1]);
+    if (!p || !p->set)
+    {
+        out.print(F("error: no writable parameter "));
+        out.println(argv[1]);
+        return;
+    }
+    char *end = nullptr;
+    long v = strtol(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || v < p->minValue || v > p->maxValue)
+    {
+        out.print(F("error: "));
+        out.print(p->name);
+        out.print(F(" takes "));
+        out.print(p->minValue);
+        out.print(F(".."));
+        out.println(p->maxValue);
+        return;
+    }
+    p->set((int32_t)v);
+    settingsMarkDirty();
+    out.print(F("ok "));
+    printParameter(out, *p);
+}
+
+static const Command commands[] = {
+    {"help", "", cmdHelp},
+    {"profile", "[weather|hvac|fast]", cmdProfile},
+    {"format", "[text|binary]", cmdFormat},
+    {"stats", "", cmdStats},
+    {"i2c", "", cmdI2c},
+    {"mem", "", cmdMem},
+    {"history", "[count]", cmdHistory},
+    {"time", "[unix seconds]", cmdTime},
+    {"get", "[name]", cmdGet},
+    {"set", "<name> <value>", cmdSet},
+    {"log", "[dump [since]|flush|erase]", cmdLog},
+    {"prof", "[reset]", cmdProf},
+    {"bench", "[runs]", cmdBench},
+};
+static const uint8_t commandCount = sizeof(commands) / sizeof(commands[0]);
+
+static void cmdHelp(Print &out, uint8_t argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    for (uint8_t i = 0; i < commandCount; i++)
+    {
+        out.print(commands[i].name);
+        out.print(' ');
+        out.println(commands[i].usage);
+    }
+}
+
+static void dispatch(Print &out)
+{
+    char *argv[CONSOLE_MAX_ARGS];
+    uint8_t argc = 0;
+    char *save = nullptr;
+    for (char *tok = strtok_r(line, " \t", &save); tok && argc < CONSOLE_MAX_ARGS;
+         tok = strtok_r(nullptr, " \t", &save))
+    {
+        argv[argc++] = tok;
+    }
+    if (argc == 0)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < commandCount; i++)
+    {
+        if (strcmp(argv[0], commands[i].name) == 0)
+        {
+            commands[i].handler(out, argc, argv);
+            return;
+        }
+    }
+    out.print(F("error: unknown command "));
+    out.println(argv[0]);
+}
+
+void consolePoll(Stream &io)
+{
+    while (io.available() > 0)
+    {
+        char c = (char)io.read();
+        if (c != '\r' && c != '\n')
+        {
+            if (lineLen < CONSOLE_LINE_MAX - 1)
+            {
+                line[lineLen++] = c;
+            }
+            else
+            {
+                overflow = true; // keep draining, reject the line at its end
+            }
+            continue;
+        }
+        if (lineLen == 0 && !overflow)
+        {
+            continue; // blank line or the second half of CRLF
+        }
+        line[lineLen] = '\0';
+        if (overflow)
+        {
+            io.println(F("error: line too long"));
+        }
+        else
+        {
+            dispatch(io);
+        }
+        if (telemetryFormat() == TELEMETRY_BINARY)
+        {
+            io.write((uint8_t)0x00); // keep the reply out of the next binary frame
+        }
+        lineLen = 0;
+        overflow = false;
+        return;
+    }
+}
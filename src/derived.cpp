@@ -0,0 +1,278 @@
+#include "derived.h"
+#include "sensors.h"
+#include "fixed_format.h"
+
+#define ONE_Q24 (1L << DERIVED_LOG_FRAC)
+#define ONE_Q30 (1L << 30)
+#define LN2_Q30 744261118   // ln 2
+#define LOG2E_Q30 1549082005 // log2 e
+
+// Magnus coefficients over water (Alduchov & Eskridge): es = 611.2 Pa * exp(a T / (b + T))
+#define MAGNUS_A_CENTI 1762
+#define MAGNUS_B_CENTI 24312
+#define MAGNUS_ES0_DECI 6112
+
+// ISA barometric formula: h = 44330 m * (1 - (p / p0)^0.190295)
+#define BARO_SCALE_CM 4433000
+#define BARO_EXP_MICRO 190295
+#define BARO_INV_EXP_MICRO 5254999 // 1 / 0.190295
+
+#define HUMIDITY_GROUP (DERIVED_BIT(DERIVED_DEWPOINT) | DERIVED_BIT(DERIVED_ABS_HUMIDITY) | DERIVED_BIT(DERIVED_HEAT_INDEX))
+#define PRESSURE_GROUP (DERIVED_BIT(DERIVED_SEA_LEVEL) | DERIVED_BIT(DERIVED_ALTITUDE))
+
+struct CacheEntry
+{
+    DerivedValues values;
+    int32_t temperature; // inputs of the humidity group when it was computed
+    uint32_t humidity;
+    uint32_t pressure;   // input of the pressure group
+};
+
+static const DerivedInfo infos[DERIVED_METRICS] = {
+    {"Dewpoint", "Dew", "C", "dewpoint_c"},
+    {"AbsHum", "AbsHum", "g/m3", "abs_hum_gm3"},
+    {"HeatIndex", "Heat", "C", "heat_index_c"},
+    {"SeaLevel", "QFF", "mBar", "sea_level_mbar"},
+    {"Altitude", "Alt", "m", "altitude_m"},
+};
+
+static DerivedConfig config = DERIVED_DEFAULT_CONFIG;
+static CacheEntry cache[FILTER_OUTPUTS][SENSOR_MAX];
+
+void derivedSetConfig(const DerivedConfig &c)
+{
+    config = c;
+    memset(cache, 0, sizeof(cache));
+}
+
+const DerivedConfig &derivedConfig()
+{
+    return config;
+}
+
+uint8_t derivedOutputs(FilterOutput out)
+{
+    return config.outputs[out];
+}
+
+const DerivedInfo &derivedInfo(DerivedMetric metric)
+{
+    return infos[metric];
+}
+
+DerivedInputs derivedInputs(const SensorReading &reading)
+{
+    DerivedInputs in = {reading.temperature, humidityCenti(reading.humidity), pressurePa(reading.pressure)};
+    return in;
+}
+
+static int64_t divRound64(int64_t value, int64_t divisor)
+{
+    return value >= 0 ? (value + divisor / 2) / divisor : -((-value + divisor / 2) / divisor);
+}
+
+static uint32_t isqrt(uint32_t x)
+{
+    uint32_t root = 0;
+    for (uint32_t bit = 1UL << 30; bit; bit >>= 2)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+int32_t derivedLog2(uint32_t x)
+{
+    uint8_t n = (uint8_t)(31 - __builtin_clz(x));
+    // Mantissa in Q30, [1, 2); each squaring doubles the log and yields one bit
+    uint32_t m = n >= 30 ? x >> (n - 30) : x << (30 - n);
+    int32_t result = (int32_t)n << DERIVED_LOG_FRAC;
+    for (int8_t bit = DERIVED_LOG_FRAC - 1; bit >= 0; bit--)
+    {
+        m = (uint32_t)(((uint64_t)m * m) >> 30);
+        if (m >= (1UL << 31))
+        {
+            m >>= 1;
+            result += 1L << bit;
+        }
+    }
+    return result;
+}
+
+uint32_t derivedExp2(int32_t y)
+{
+    // y = k + f with f in [-0.5, 0.5), so e^(f ln 2) needs few terms
+    int32_t k = (y + (1L << (DERIVED_LOG_FRAC - 1))) >> DERIVED_LOG_FRAC;
+    if (k >= 8)
+    {
+        return UINT32_MAX;
+    }
+    int32_t f = y - k * ONE_Q24;
+    int64_t z = ((int64_t)f * LN2_Q30) >> DERIVED_LOG_FRAC; // Q30, |z| <= 0.35
+    int64_t t = ONE_Q30;
+    for (uint8_t d = 6; d >= 1; d--)
+    {
+        t = ONE_Q30 + ((z * t) >> 30) / d; // Horner form of the Taylor series
+    }
+    int8_t shift = (int8_t)(k - (30 - DERIVED_LOG_FRAC));
+    if (shift >= 0)
+    {
+        return (uint32_t)(t << shift);
+    }
+    if (shift <= -31)
+    {
+        return 0;
+    }
+    return (uint32_t)((t + (1LL << (-shift - 1))) >> -shift);
+}
+
+// a T / (b + T) of the Magnus formula, in Q24
+static int32_t magnusExponent(int32_t temperature)
+{
+    return (int32_t)(((int64_t)MAGNUS_A_CENTI * temperature * ONE_Q24) /
+                     ((int64_t)100 * (MAGNUS_B_CENTI + temperature)));
+}
+
+static int32_t dewpoint(int32_t exponent, uint32_t humidity)
+{
+    // gamma = ln(RH / 100 %) + a T / (b + T); Td = b gamma / (a - gamma)
+    int32_t lnRh = (int32_t)(((int64_t)(derivedLog2(humidity) - derivedLog2(10000)) * LN2_Q30) >> 30);
+    int64_t gamma = (int64_t)exponent + lnRh;
+    int64_t a = ((int64_t)MAGNUS_A_CENTI * ONE_Q24) / 100;
+    return (int32_t)divRound64(MAGNUS_B_CENTI * gamma, a - gamma);
+}
+
+static int32_t absoluteHumidity(int32_t temperature, int32_t exponent, uint32_t humidity)
+{
+    // rho = e / (Rv T) with e = RH es(T); in centi-g/m^3 that is
+    // e[Pa] * 2e7 / (923 * T[centi-K])
+    uint32_t ratio = derivedExp2((int32_t)(((int64_t)exponent * LOG2E_Q30) >> 30)); // es / 611.2 Pa, Q24
+    uint64_t vapour = ((uint64_t)ratio * MAGNUS_ES0_DECI * humidity) >> 8; // Pa * 1e5 * 2^16
+    uint64_t divisor = ((uint64_t)923 << 16) * (uint32_t)(temperature + 27315);
+    return (int32_t)((vapour * 200 + divisor / 2) / divisor);
+}
+
+static int32_t heatIndex(int32_t temperature, uint32_t humidity)
+{
+    int32_t t = divRound(temperature * 9, 5) + 3200; // centi-degF
+    int32_t h = (int32_t)humidity;
+    // Steadman's simple form, averaged with the temperature, picks the regime
+    int32_t hi = (t + 6100 + (t - 6800) * 12 / 10 + h * 94 / 1000) / 2;
+    if ((hi + t) / 2 >= 8000)
+    {
+        // Rothfusz regression in tenths of degF and %RH; coefficients x 1e8
+        int64_t T = divRound(t, 10);
+        int64_t R = (h + 5) / 10;
+        int64_t sum = -4237900000LL + 204901523LL * T / 10 + 1014333127LL * R / 10 - 22475541LL * T * R / 100 -
+                      683783LL * T * T / 100 - 5481717LL * R * R / 100 + 122874LL * T * T * R / 1000 +
+                      85282LL * T * R * R / 1000 - 199LL * T * T * R * R / 10000;
+        hi = (int32_t)divRound64(sum, 1000000);
+        if (h < 1300 && t >= 8000 && t <= 11200)
+        {
+            // - (13 - RH) / 4 * sqrt((17 - |T - 95|) / 17)
+            uint32_t root = isqrt(((uint32_t)(1700 - abs(t - 9500)) << 16) / 1700); // Q8
+            hi -= (int32_t)(((uint32_t)(1300 - h) / 4 * root) >> 8);
+        }
+        else if (h > 8500 && t >= 8000 && t <= 8700)
+        {
+            hi += (h - 8500) * (8700 - t) / 5000; // + (RH - 85) / 10 * (87 - T) / 5
+        }
+    }
+    return divRound((hi - 3200) * 5, 9);
+}
+
+static uint32_t seaLevelPressure(uint32_t pressure, int16_t elevationM)
+{
+    // p0 = p / (1 - h / 44330 m)^5.255
+    uint32_t base = (uint32_t)(ONE_Q24 - ((int64_t)elevationM * 100 * ONE_Q24) / BARO_SCALE_CM);
+    int32_t lb = derivedLog2(base) - DERIVED_LOG_FRAC * ONE_Q24;
+    uint32_t factor = derivedExp2((int32_t)(-(int64_t)lb * BARO_INV_EXP_MICRO / 1000000));
+    return (uint32_t)(((uint64_t)pressure * factor + ONE_Q24 / 2) >> DERIVED_LOG_FRAC);
+}
+
+static int32_t altitude(uint32_t pressure, uint32_t qnhPa)
+{
+    int32_t lr = derivedLog2(pressure) - derivedLog2(qnhPa);
+    uint32_t factor = derivedExp2((int32_t)((int64_t)lr * BARO_EXP_MICRO / 1000000)); // (p / p0)^0.190295
+    return (int32_t)divRound64((int64_t)BARO_SCALE_CM * (ONE_Q24 - (int64_t)factor), ONE_Q24);
+}
+
+static void computeHumidity(const DerivedInputs &in, uint8_t mask, DerivedValues &out)
+{
+    uint32_t humidity = in.humidity < 1 ? 1 : in.humidity > 10000 ? 10000 : in.humidity; // ln 0 has no dewpoint
+    int32_t exponent = magnusExponent(in.temperature);
+    if (mask & DERIVED_BIT(DERIVED_DEWPOINT))
+    {
+        out.value[DERIVED_DEWPOINT] = dewpoint(exponent, humidity);
+    }
+    if (mask & DERIVED_BIT(DERIVED_ABS_HUMIDITY))
+    {
+        out.value[DERIVED_ABS_HUMIDITY] = absoluteHumidity(in.temperature, exponent, humidity);
+    }
+    if (mask & DERIVED_BIT(DERIVED_HEAT_INDEX))
+    {
+        out.value[DERIVED_HEAT_INDEX] = heatIndex(in.temperature, humidity);
+    }
+}
+
+static void computePressure(const DerivedInputs &in, uint8_t mask, DerivedValues &out)
+{
+    uint32_t pressure = in.pressure ? in.pressure : 1;
+    if (mask & DERIVED_BIT(DERIVED_SEA_LEVEL))
+    {
+        out.value[DERIVED_SEA_LEVEL] = (int32_t)seaLevelPressure(pressure, config.elevationM);
+    }
+    if (mask & DERIVED_BIT(DERIVED_ALTITUDE))
+    {
+        out.value[DERIVED_ALTITUDE] = altitude(pressure, config.qnhPa);
+    }
+}
+
+void derivedCompute(const DerivedInputs &in, uint8_t mask, DerivedValues &out)
+{
+    mask &= DERIVED_ALL;
+    computeHumidity(in, mask & HUMIDITY_GROUP, out);
+    computePressure(in, mask & PRESSURE_GROUP, out);
+    out.mask = mask;
+}
+
+const DerivedValues &derivedFor(FilterOutput out, uint8_t sensor, const SensorReading &reading)
+{
+    static DerivedValues scratch; // outputs beyond the registry, uncached
+    uint8_t mask = config.outputs[out] & DERIVED_ALL;
+    DerivedInputs in = derivedInputs(reading);
+    if (sensor >= SENSOR_MAX)
+    {
+        derivedCompute(in, mask, scratch);
+        return scratch;
+    }
+    CacheEntry &e = cache[out][sensor];
+    // A group is recomputed if a selected metric is missing or an input moved past its step
+    uint8_t humidity = mask & HUMIDITY_GROUP;
+    if (humidity && ((humidity & ~e.values.mask) || abs(in.temperature - e.temperature) > DERIVED_TEMP_STEP ||
+        abs((int32_t)in.humidity - (int32_t)e.humidity) > DERIVED_HUM_STEP))
+    {
+        computeHumidity(in, humidity, e.values);
+        e.temperature = in.temperature;
+        e.humidity = in.humidity;
+        e.values.mask = (uint8_t)((e.values.mask & ~HUMIDITY_GROUP) | humidity);
+    }
+    uint8_t pressure = mask & PRESSURE_GROUP;
+    if (pressure &&
+        ((pressure & ~e.values.mask) || abs((int32_t)in.pressure - (int32_t)e.pressure) > DERIVED_PRESS_STEP))
+    {
+        computePressure(in, pressure, e.values);
+        e.pressure = in.pressure;
+        e.values.mask = (uint8_t)((e.values.mask & ~PRESSURE_GROUP) | pressure);
+    }
+    e.values.mask &= mask; // metrics dropped from the selection since
+    return e.values;
+}
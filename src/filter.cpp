@@ -0,0 +1,154 @@
+#include "filter.h"
+#include "sensors.h"
+
+// The EMA keeps FRAC_BITS below the reading's own resolution, so that it
+// settles on the input instead of stalling up to 2^(emaShift-1) units away
+#define FRAC_BITS 4
+
+struct ChannelState
+{
+    int32_t window[3]; // last raw samples, for the median
+    int32_t ema;       // in units of 2^-FRAC_BITS of the reading
+};
+
+struct SensorState
+{
+    ChannelState channels[FILTER_CHANNELS];
+    uint8_t samples; // seen since the last restart, saturates at 3
+};
+
+struct ReportState
+{
+    int32_t last[FILTER_CHANNELS]; // deadband units
+    uint32_t ms;
+    bool valid;
+};
+
+static FilterConfig config = FILTER_DEFAULT_CONFIG;
+static SensorState sensors[SENSOR_MAX];
+static ReportState reports[FILTER_OUTPUTS][SENSOR_MAX];
+static FilterCounts counts[FILTER_OUTPUTS];
+
+void filterSetConfig(const FilterConfig &c)
+{
+    config = c;
+    if (config.mode >= FILTER_MODES)
+    {
+        config.mode = FILTER_NONE;
+    }
+    config.emaShift = constrain(config.emaShift, 1, FILTER_EMA_SHIFT_MAX);
+    memset(sensors, 0, sizeof(sensors));
+    memset(reports, 0, sizeof(reports));
+}
+
+const FilterConfig &filterConfig()
+{
+    return config;
+}
+
+static int32_t median3(int32_t a, int32_t b, int32_t c)
+{
+    return max(min(a, b), min(max(a, b), c));
+}
+
+static int32_t filterChannel(ChannelState &ch, uint8_t samples, int32_t x)
+{
+    ch.window[2] = ch.window[1];
+    ch.window[1] = ch.window[0];
+    ch.window[0] = x;
+    if ((config.mode == FILTER_MEDIAN || config.mode == FILTER_MEDIAN_EMA) && samples >= 3)
+    {
+        x = median3(ch.window[0], ch.window[1], ch.window[2]);
+    }
+    if (config.mode == FILTER_EMA || config.mode == FILTER_MEDIAN_EMA)
+    {
+        int32_t scaled = x * (1 << FRAC_BITS);
+        if (samples == 1)
+        {
+            ch.ema = scaled; // primed with the first sample, no ramp from zero
+        }
+        else
+        {
+            ch.ema += (scaled - ch.ema + (1 << (config.emaShift - 1))) >> config.emaShift;
+        }
+        x = (ch.ema + (1 << (FRAC_BITS - 1))) >> FRAC_BITS;
+    }
+    return x;
+}
+
+void filterApply(uint8_t sensor, SensorReading &reading)
+{
+    if (sensor >= SENSOR_MAX || config.mode == FILTER_NONE)
+    {
+        return;
+    }
+    SensorState &s = sensors[sensor];
+    if (s.samples < 3)
+    {
+        s.samples++;
+    }
+    // Raw fixed-point fields; Q24.8 pressure stays below 2^27, so the
+    // extra EMA bits still fit in 32 bits
+    reading.temperature = filterChannel(s.channels[FILTER_TEMPERATURE], s.samples, reading.temperature);
+    reading.humidity = (uint32_t)filterChannel(s.channels[FILTER_HUMIDITY], s.samples, (int32_t)reading.humidity);
+    reading.pressure = (uint32_t)filterChannel(s.channels[FILTER_PRESSURE], s.samples, (int32_t)reading.pressure);
+}
+
+static void deadbandUnits(const SensorReading &reading, int32_t *v)
+{
+    v[FILTER_TEMPERATURE] = reading.temperature;
+    v[FILTER_HUMIDITY] = (int32_t)humidityCenti(reading.humidity);
+    v[FILTER_PRESSURE] = (int32_t)pressurePa(reading.pressure);
+}
+
+bool filterDue(FilterOutput out, uint8_t sensor, const SensorReading &reading, uint32_t nowMs)
+{
+    counts[out].offered++;
+    if (sensor >= SENSOR_MAX || config.heartbeatS == 0)
+    {
+        return true;
+    }
+    const ReportState &r = reports[out][sensor];
+    if (!r.valid || (nowMs - r.ms) >= config.heartbeatS * 1000UL)
+    {
+        return true;
+    }
+    int32_t v[FILTER_CHANNELS];
+    deadbandUnits(reading, v);
+    for (uint8_t c = 0; c < FILTER_CHANNELS; c++)
+    {
+        if (abs(v[c] - r.last[c]) > (int32_t)config.deadband[c])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void filterReported(FilterOutput out, uint8_t sensor, const SensorReading &reading, uint32_t nowMs)
+{
+    counts[out].reported++;
+    if (sensor >= SENSOR_MAX)
+    {
+        return;
+    }
+    ReportState &r = reports[out][sensor];
+    deadbandUnits(reading, r.last);
+    r.ms = nowMs;
+    r.valid = true;
+}
+
+bool filterReport(FilterOutput out, uint8_t sensor, const SensorReading &reading, uint32_t nowMs)
+{
+    if (!filterDue(out, sensor, reading, nowMs))
+    {
+        return false;
+    }
+    filterReported(out, sensor, reading, nowMs);
+    return true;
+}
+
+FilterCounts filterCounts(FilterOutput out)
+{
+    return counts[out];
+}
@@ -0,0 +1,57 @@
+#include "fixed_format.h"
+
+size_t formatFixed(char *buf, size_t size, int32_t value, uint8_t decimals, uint8_t width)
+{
+    // Build the digits backwards into a scratch buffer
+    char tmp[16];
+    size_t n = 0;
+    bool negative = value < 0;
+    uint32_t v = negative ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    for (uint8_t d = 0; d < decimals; d++)
+    {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    }
+    if (decimals)
+    {
+        tmp[n++] = '.';
+    }
+    do
+    {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v && n < sizeof(tmp) - 1);
+    if (negative)
+    {
+        tmp[n++] = '-';
+    }
+
+    size_t pad = width > n ? width - n : 0;
+    size_t total = pad + n;
+    if (size == 0)
+    {
+        return 0;
+    }
+    if (total >= size)
+    {
+        total = size - 1;
+    }
+    size_t o = 0;
+    for (; o < pad && o < total; o++)
+    {
+        buf[o] = ' ';
+    }
+    while (o < total)
+    {
+        buf[o++] = tmp[--n];
+    }
+    buf[o] = '\0';
+    return o;
+}
+
+void printFixed(Print &out, int32_t value, uint8_t decimals)
+{
+    char buf[16];
+    formatFixed(buf, sizeof(buf), value, decimals);
+    out.print(buf);
+}
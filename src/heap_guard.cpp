@@ -0,0 +1,90 @@
+#include "heap_guard.h"
+
+#if defined(ARDUINO_ARCH_STM32)
+#include <errno.h>
+#include <malloc.h>
+#define HEAP_GUARD_HARDWARE 1
+#ifndef USE_FREERTOS
+#define HEAP_GUARD_SBRK 1 // replaces the core's weak _sbrk()
+#endif
+
+extern "C" char _sdata;          // start of RAM data, from the linker
+extern "C" char _end;            // start of the heap
+extern "C" char _estack;         // top of RAM
+extern "C" char _Min_Stack_Size; // reserved for the main stack
+#endif
+
+static bool locked = false;
+static uint32_t lockedBrk = 0;
+static uint32_t refused = 0;
+
+#ifdef HEAP_GUARD_SBRK
+static char *heapEnd = &_end;
+
+// The core's _sbrk(), plus the lock
+extern "C" void *_sbrk(ptrdiff_t incr)
+{
+    char *prev = heapEnd;
+    if (locked && incr > 0)
+    {
+        refused++;
+        errno = ENOMEM;
+        return (void *)-1;
+    }
+    if (heapEnd + incr > (char *)__get_MSP() || heapEnd + incr >= &_estack - (uintptr_t)&_Min_Stack_Size)
+    {
+        errno = ENOMEM; // would run into the stack
+        return (void *)-1;
+    }
+    heapEnd += incr;
+    return prev;
+}
+#endif
+
+// Current break. mallinfo().arena is what malloc took from _sbrk() in
+// total, which also covers the RTOS build's own _sbrk().
+static uint32_t currentBrk()
+{
+#ifdef HEAP_GUARD_HARDWARE
+    return (uint32_t)mallinfo().arena;
+#else
+    return 0;
+#endif
+}
+
+void heapGuardLock()
+{
+    lockedBrk = currentBrk();
+    locked = true;
+}
+
+bool heapGuardLocked()
+{
+    return locked;
+}
+
+bool heapGuardGrown()
+{
+    return locked && currentBrk() > lockedBrk;
+}
+
+HeapGuardStats heapGuardStats()
+{
+    HeapGuardStats st;
+#ifdef HEAP_GUARD_HARDWARE
+    st.staticBytes = (uint32_t)(&_end - &_sdata);
+#else
+    st.staticBytes = 0;
+#endif
+    st.lockedBytes = lockedBrk;
+    st.heapBytes = currentBrk();
+    st.refused = refused;
+#ifdef HEAP_GUARD_HARDWARE
+    uint32_t sp = (uint32_t)__get_MSP();
+    uint32_t top = (uint32_t)&_end + st.heapBytes;
+    st.freeBytes = sp > top ? sp - top : 0;
+#else
+    st.freeBytes = 0;
+#endif
+    return st;
+}
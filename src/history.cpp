@@ -0,0 +1,242 @@
+#include "history.h"
+
+struct BlockSummary
+{
+    int32_t min[HIST_CHANNELS];
+    int32_t max[HIST_CHANNELS];
+    int32_t sum[HIST_CHANNELS];
+    uint32_t startTime; // wall clock seconds of the first sample
+    uint8_t count;
+};
+
+static HistorySample ring[HISTORY_CAPACITY];
+static BlockSummary blocks[HISTORY_BLOCKS];
+static uint16_t head = 0;  // next write position
+static uint16_t stored = 0; // valid samples in the ring
+static uint32_t total = 0;  // samples added since the last clear
+
+// Running statistics over every block that is part of the window
+static int32_t windowMin[HIST_CHANNELS];
+static int32_t windowMax[HIST_CHANNELS];
+static int64_t windowSum[HIST_CHANNELS];
+static uint16_t windowCount = 0;
+
+static uint32_t lastAddMs = 0;
+static bool haveAdded = false;
+
+static void resetBlock(BlockSummary &b)
+{
+    for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+    {
+        b.min[c] = INT32_MAX;
+        b.max[c] = INT32_MIN;
+        b.sum[c] = 0;
+    }
+    b.startTime = 0;
+    b.count = 0;
+}
+
+static void rebuildWindowExtremes()
+{
+    for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+    {
+        windowMin[c] = INT32_MAX;
+        windowMax[c] = INT32_MIN;
+        for (uint16_t i = 0; i < HISTORY_BLOCKS; i++)
+        {
+            if (blocks[i].count == 0)
+            {
+                continue;
+            }
+            windowMin[c] = min(windowMin[c], blocks[i].min[c]);
+            windowMax[c] = max(windowMax[c], blocks[i].max[c]);
+        }
+    }
+}
+
+void historyClear()
+{
+    for (uint16_t i = 0; i < HISTORY_BLOCKS; i++)
+    {
+        resetBlock(blocks[i]);
+    }
+    for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+    {
+        windowMin[c] = INT32_MAX;
+        windowMax[c] = INT32_MIN;
+        windowSum[c] = 0;
+    }
+    windowCount = 0;
+    head = 0;
+    stored = 0;
+    total = 0;
+    haveAdded = false;
+}
+
+int32_t historyValue(const HistorySample &s, HistoryChannel channel)
+{
+    switch (channel)
+    {
+    case HIST_TEMPERATURE:
+        return s.temperature;
+    case HIST_HUMIDITY:
+        return s.humidity;
+    case HIST_PRESSURE:
+        return (int32_t)s.pressure[0] | ((int32_t)s.pressure[1] << 8) | ((int32_t)s.pressure[2] << 16);
+    default:
+        return 0;
+    }
+}
+
+bool historyAdd(const SensorReading &reading, uint32_t nowMs, uint32_t timeS)
+{
+    if (!haveAdded)
+    {
+        historyClear();
+        haveAdded = true;
+        lastAddMs = nowMs;
+    }
+    else if ((nowMs - lastAddMs) < HISTORY_INTERVAL_MS)
+    {
+        return false;
+    }
+    else
+    {
+        // Fixed-rate decimation clock, re-anchored after a long gap
+        lastAddMs += HISTORY_INTERVAL_MS;
+        if ((nowMs - lastAddMs) >= HISTORY_INTERVAL_MS)
+        {
+            lastAddMs = nowMs;
+        }
+    }
+
+    BlockSummary &block = blocks[head / HISTORY_BLOCK];
+    if (head % HISTORY_BLOCK == 0 && block.count != 0)
+    {
+        // Wrapping into an old block: it leaves the statistics window
+        for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+        {
+            windowSum[c] -= block.sum[c];
+        }
+        windowCount -= block.count;
+        resetBlock(block);
+        rebuildWindowExtremes();
+    }
+    if (block.count == 0)
+    {
+        block.startTime = timeS;
+    }
+
+    HistorySample &s = ring[head];
+    s.temperature = (int16_t)reading.temperature;
+    s.humidity = (uint16_t)humidityCenti(reading.humidity);
+    uint32_t pa = pressurePa(reading.pressure);
+    s.pressure[0] = (uint8_t)pa;
+    s.pressure[1] = (uint8_t)(pa >> 8);
+    s.pressure[2] = (uint8_t)(pa >> 16);
+    uint32_t offset = timeS - block.startTime;
+    s.offset = (uint16_t)(offset < UINT16_MAX ? offset : UINT16_MAX);
+
+    for (uint8_t c = 0; c < HIST_CHANNELS; c++)
+    {
+        int32_t v = historyValue(s, (HistoryChannel)c);
+        block.min[c] = min(block.min[c], v);
+        block.max[c] = max(block.max[c], v);
+        block.sum[c] += v;
+        windowMin[c] = min(windowMin[c], v);
+        windowMax[c] = max(windowMax[c], v);
+        windowSum[c] += v;
+    }
+    block.count++;
+    windowCount++;
+
+    head = (head + 1) % HISTORY_CAPACITY;
+    if (stored < HISTORY_CAPACITY)
+    {
+        stored++;
+    }
+    total++;
+    return true;
+}
+
+uint16_t historyCount()
+{
+    return stored;
+}
+
+uint32_t historyTotal()
+{
+    return total;
+}
+
+bool historyGet(uint16_t age, HistorySample &out)
+{
+    if (age >= stored)
+    {
+        return false;
+    }
+    uint16_t idx = (uint16_t)((head + HISTORY_CAPACITY - 1 - age) % HISTORY_CAPACITY);
+    out = ring[idx];
+    return true;
+}
+
+bool historyTime(uint16_t age, uint32_t &seconds)
+{
+    if (age >= stored)
+    {
+        return false;
+    }
+    uint16_t idx = (uint16_t)((head + HISTORY_CAPACITY - 1 - age) % HISTORY_CAPACITY);
+    seconds = blocks[idx / HISTORY_BLOCK].startTime + ring[idx].offset;
+    return true;
+}
+
+HistoryStats historyStats(HistoryChannel channel)
+{
+    HistoryStats st = {0, 0, 0, windowCount};
+    if (windowCount == 0 || channel >= HIST_CHANNELS)
+    {
+        return st;
+    }
+    st.min = windowMin[channel];
+    st.max = windowMax[channel];
+    st.mean = (int32_t)(windowSum[channel] / windowCount);
+    return st;
+}
+
+bool historyPressureTrend(int32_t &paPer3h)
+{
+    // The block being written is incomplete; the newest complete one is
+    // just before it, and the oldest in the window is just after it.
+    uint16_t current = head / HISTORY_BLOCK;
+    uint16_t newest = (current + HISTORY_BLOCKS - 1) % HISTORY_BLOCKS;
+    uint16_t oldest = (current + 1) % HISTORY_BLOCKS;
+    uint16_t spanBlocks = HISTORY_BLOCKS - 2;
+    if (stored < HISTORY_CAPACITY)
+    {
+        // Not wrapped yet: the oldest block is the first one
+        oldest = 0;
+        spanBlocks = newest - oldest;
+    }
+    if (current == 0 && stored < HISTORY_CAPACITY)
+    {
+        return false;
+    }
+    const BlockSummary &a = blocks[oldest];
+    const BlockSummary &b = blocks[newest];
+    if (spanBlocks == 0 || a.count != HISTORY_BLOCK || b.count != HISTORY_BLOCK)
+    {
+        return false;
+    }
+    int32_t meanA = a.sum[HIST_PRESSURE] / HISTORY_BLOCK;
+    int32_t meanB = b.sum[HIST_PRESSURE] / HISTORY_BLOCK;
+    const int32_t threeHoursS = 3L * 3600L;
+    int32_t spanS = (int32_t)(b.startTime - a.startTime);
+    if (spanS <= 0)
+    {
+        // Clock set back in between; assume the nominal sample spacing
+        spanS = (int32_t)spanBlocks * HISTORY_BLOCK * (HISTORY_INTERVAL_MS / 1000);
+    }
+    paPer3h = (int32_t)((int64_t)(meanB - meanA) * threeHoursS / spanS);
+    return true;
+}
@@ -0,0 +1,388 @@
+#include "i2c_bus.h"
+
+#define BME280_REG_CHIPID 0xD0
+#define BME280_CHIPID 0x60
+#define BME280_REG_CALIB 0x88
+#define BME280_CALIB_LEN 26
+
+// Candidate clocks, fastest first. The STM32F4 I2C peripheral stops at
+// fast mode, so fast-mode plus is only tried where the core supports it.
+static const uint32_t clockTable[] = {
+#if defined(I2C_FASTMODEPLUS_ENABLE)
+    I2C_CLOCK_FAST_PLUS,
+#endif
+    I2C_CLOCK_FAST,
+    250000,
+    I2C_CLOCK_STANDARD,
+};
+static const uint8_t clockCount = sizeof(clockTable) / sizeof(clockTable[0]);
+
+// Manual line control needs the pins as GPIOs; host builds have none
+#if defined(ARDUINO_ARCH_STM32)
+#define I2C_LINE_CONTROL 1
+#define RECOVERY_HALF_PERIOD_US 5 // 100 kHz
+#define RECOVERY_CLOCKS 9         // enough for a slave stuck mid-byte to finish it
+#endif
+
+static I2cBus *buses[I2C_MAX_BUSES];
+static uint8_t busCount = 0;
+
+void i2cBusBegin(I2cBus &bus, TwoWire *wire)
+{
+    bus.wire = wire;
+    bus.clockIndex = clockCount - 1;
+    bus.errorStreak = 0;
+    bus.sda = I2C_NO_PIN;
+    bus.scl = I2C_NO_PIN;
+    bus.faulted = false;
+    bus.backoffMs = 0;
+    bus.retryMs = 0;
+    memset(&bus.health, 0, sizeof(bus.health));
+    wire->setClock(clockTable[bus.clockIndex]);
+    for (uint8_t i = 0; i < busCount; i++)
+    {
+        if (buses[i] == &bus)
+        {
+            return;
+        }
+    }
+    if (busCount < I2C_MAX_BUSES)
+    {
+        buses[busCount++] = &bus;
+    }
+}
+
+void i2cBusSetPins(I2cBus &bus, uint32_t sda, uint32_t scl)
+{
+    bus.sda = sda;
+    bus.scl = scl;
+}
+
+uint8_t i2cBusCount()
+{
+    return busCount;
+}
+
+I2cBus &i2cBusAt(uint8_t index)
+{
+    return *buses[index];
+}
+
+static I2cBus *busOf(TwoWire *wire)
+{
+    for (uint8_t i = 0; i < busCount; i++)
+    {
+        if (buses[i]->wire == wire)
+        {
+            return buses[i];
+        }
+    }
+    return nullptr;
+}
+
+static void fault(I2cBus &bus)
+{
+    if (bus.faulted)
+    {
+        return;
+    }
+    bus.faulted = true;
+    bus.backoffMs = 0;
+    bus.retryMs = millis(); // first attempt right away
+}
+
+// An idle bus has both lines high; the helpers always finish with a STOP
+static bool linesIdle(const I2cBus &bus)
+{
+#ifdef I2C_LINE_CONTROL
+    if (bus.sda != I2C_NO_PIN && bus.scl != I2C_NO_PIN)
+    {
+        return digitalRead(bus.sda) == HIGH && digitalRead(bus.scl) == HIGH;
+    }
+#else
+    (void)bus;
+#endif
+    return true;
+}
+
+bool i2cWireReady(TwoWire *wire)
+{
+    I2cBus *bus = busOf(wire);
+    if (!bus)
+    {
+        return true;
+    }
+    if (bus->faulted)
+    {
+        return false;
+    }
+    if (!linesIdle(*bus))
+    {
+        bus->health.timeouts++;
+        fault(*bus);
+        return false;
+    }
+    return true;
+}
+
+bool i2cRecordStatus(TwoWire *wire, uint8_t status)
+{
+    I2cBus *bus = busOf(wire);
+    if (!bus)
+    {
+        return status == I2C_STATUS_OK;
+    }
+    bus->health.transactions++;
+    switch (status)
+    {
+    case I2C_STATUS_OK:
+        return true;
+    case I2C_STATUS_NACK_ADDR:
+    case I2C_STATUS_NACK_DATA:
+        bus->health.nacks++; // the device is absent or busy, the bus is fine
+        return false;
+    case I2C_STATUS_TIMEOUT:
+        bus->health.timeouts++;
+        fault(*bus);
+        return false;
+    default:
+        bus->health.errors++;
+        if (status >= I2C_STATUS_OTHER)
+        {
+            fault(*bus);
+        }
+        return false;
+    }
+}
+
+// Clocks SCL until the slave releases SDA, then sends a STOP and restarts
+// the peripheral, which also clears a BUSY flag latched by the glitch.
+// Takes about 100 us. Returns true if both lines are idle afterwards.
+static bool recover(I2cBus &bus)
+{
+    bus.health.recoveries++;
+#ifdef I2C_LINE_CONTROL
+    if (bus.sda != I2C_NO_PIN && bus.scl != I2C_NO_PIN)
+    {
+        bus.wire->end();
+        pinMode(bus.sda, INPUT_PULLUP);
+        pinMode(bus.scl, OUTPUT_OPEN_DRAIN);
+        digitalWrite(bus.scl, HIGH);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        for (uint8_t i = 0; i < RECOVERY_CLOCKS && digitalRead(bus.sda) == LOW; i++)
+        {
+            digitalWrite(bus.scl, LOW);
+            delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+            digitalWrite(bus.scl, HIGH);
+            delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        }
+        // STOP: SDA rises while SCL is high
+        pinMode(bus.sda, OUTPUT_OPEN_DRAIN);
+        digitalWrite(bus.sda, LOW);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        digitalWrite(bus.sda, HIGH);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    }
+#endif
+    bus.wire->begin();
+    i2cBusApplyClock(bus);
+    return linesIdle(bus);
+}
+
+bool i2cBusService(I2cBus &bus, uint32_t nowMs, Print &log)
+{
+    if (!bus.faulted || (int32_t)(nowMs - bus.retryMs) < 0)
+    {
+        return false;
+    }
+    if (recover(bus))
+    {
+        bus.faulted = false;
+        bus.backoffMs = 0;
+        bus.errorStreak = 0;
+        log.println(F("I2C bus recovered"));
+        return true;
+    }
+    bus.backoffMs = bus.backoffMs ? (uint16_t)min(bus.backoffMs * 2, I2C_BACKOFF_MAX_MS) : I2C_BACKOFF_MIN_MS;
+    bus.retryMs = nowMs + bus.backoffMs;
+    if (bus.backoffMs == I2C_BACKOFF_MIN_MS)
+    {
+        log.println(F("I2C bus stuck, retrying with backoff"));
+    }
+    return false;
+}
+
+bool i2cBusRetryMs(const I2cBus &bus, uint32_t &atMs)
+{
+    atMs = bus.retryMs;
+    return bus.faulted;
+}
+
+static bool probeAt(I2cBus &bus, const I2cDevice &dev, uint32_t clock)
+{
+    bus.wire->setClock(clock);
+    for (uint8_t i = 0; i < I2C_PROBE_REPEATS; i++)
+    {
+        if (!dev.probe(bus.wire, dev.addr))
+        {
+            // Too fast a clock can glitch the bus; free it for the next candidate
+            if (bus.faulted && recover(bus))
+            {
+                bus.faulted = false;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t i2cBusNegotiate(I2cBus &bus, I2cDevice *devices, uint8_t count, Print &log)
+{
+    uint8_t busIndex = 0; // fastest; each present device can only slow it down
+    bool anyPresent = false;
+
+    for (uint8_t d = 0; d < count; d++)
+    {
+        I2cDevice &dev = devices[d];
+        dev.maxClock = 0;
+        for (uint8_t c = 0; c < clockCount; c++)
+        {
+            if (probeAt(bus, dev, clockTable[c]))
+            {
+                dev.maxClock = clockTable[c];
+                if (c > busIndex)
+                {
+                    busIndex = c;
+                }
+                anyPresent = true;
+                break;
+            }
+        }
+        log.print(F("I2C probe "));
+        log.print(dev.name);
+        log.print(F(" @0x"));
+        log.print(dev.addr, HEX);
+        if (dev.maxClock)
+        {
+            log.print(F(": max "));
+            log.print(dev.maxClock / 1000);
+            log.println(F(" kHz"));
+        }
+        else
+        {
+            log.println(F(": no response"));
+        }
+    }
+
+    bus.clockIndex = anyPresent ? busIndex : clockCount - 1;
+    bus.errorStreak = 0;
+    i2cBusApplyClock(bus);
+    log.print(F("I2C bus clock: "));
+    log.print(i2cBusClock(bus) / 1000);
+    log.println(F(" kHz"));
+    return i2cBusClock(bus);
+}
+
+uint32_t i2cBusClock(const I2cBus &bus)
+{
+    return clockTable[bus.clockIndex];
+}
+
+void i2cBusApplyClock(I2cBus &bus)
+{
+    bus.wire->setClock(clockTable[bus.clockIndex]);
+}
+
+void i2cBusRecordResult(I2cBus &bus, bool ok, Print &log)
+{
+    if (ok)
+    {
+        bus.errorStreak = 0;
+        return;
+    }
+    if (++bus.errorStreak < I2C_ERROR_STEP_DOWN || bus.clockIndex + 1 >= clockCount)
+    {
+        return;
+    }
+    bus.clockIndex++;
+    bus.errorStreak = 0;
+    i2cBusApplyClock(bus);
+    log.print(F("I2C errors, bus clock lowered to "));
+    log.print(i2cBusClock(bus) / 1000);
+    log.println(F(" kHz"));
+}
+
+bool i2cReadRegisters(TwoWire *wire, uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len)
+{
+    if (!i2cWireReady(wire))
+    {
+        return false;
+    }
+    wire->beginTransmission(addr);
+    wire->write(reg);
+    // One transaction: the register write is counted only if it ends it
+    uint8_t status = wire->endTransmission(false);
+    if (status != I2C_STATUS_OK)
+    {
+        i2cRecordStatus(wire, status);
+        return false;
+    }
+    if (wire->requestFrom(addr, len) != len)
+    {
+        i2cRecordStatus(wire, I2C_STATUS_NACK_DATA); // the core reports no reason
+        return false;
+    }
+    i2cRecordStatus(wire, I2C_STATUS_OK);
+    for (uint8_t i = 0; i < len; i++)
+    {
+        buf[i] = (uint8_t)wire->read();
+    }
+    return true;
+}
+
+bool i2cWriteRegister(TwoWire *wire, uint8_t addr, uint8_t reg, uint8_t value)
+{
+    if (!i2cWireReady(wire))
+    {
+        return false;
+    }
+    wire->beginTransmission(addr);
+    wire->write(reg);
+    wire->write(value);
+    return i2cRecordStatus(wire, wire->endTransmission());
+}
+
+bool i2cProbeBme280(TwoWire *wire, uint8_t addr)
+{
+    uint8_t id;
+    if (!i2cReadRegisters(wire, addr, BME280_REG_CHIPID, &id, 1) || id != BME280_CHIPID)
+    {
+        return false;
+    }
+    // A long read twice: marginal clocks show up as mismatched bytes
+    uint8_t a[BME280_CALIB_LEN];
+    uint8_t b[BME280_CALIB_LEN];
+    return i2cReadRegisters(wire, addr, BME280_REG_CALIB, a, sizeof(a)) &&
+           i2cReadRegisters(wire, addr, BME280_REG_CALIB, b, sizeof(b)) &&
+           memcmp(a, b, sizeof(a)) == 0;
+}
+
+bool i2cProbeSh1106(TwoWire *wire, uint8_t addr)
+{
+    if (!i2cWireReady(wire))
+    {
+        return false;
+    }
+    wire->beginTransmission(addr);
+    if (!i2cRecordStatus(wire, wire->endTransmission()))
+    {
+        return false;
+    }
+    // A read returns the controller status byte
+    if (wire->requestFrom(addr, (uint8_t)1) != 1)
+    {
+        return false;
+    }
+    wire->read();
+    return true;
+}
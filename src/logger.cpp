@@ -0,0 +1,582 @@
+#include "logger.h"
+#include "sensors.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "rtc_time.h"
+
+#if defined(ARDUINO_ARCH_STM32) && defined(STM32F4xx)
+#define LOGGER_FLASH 1
+#endif
+
+#define LOG_MAGIC 0x474F4C53 // "SLOG"
+#define LOG_SECTORS 2
+#define LOG_SECTOR_SIZE 0x20000
+#define LOG_HEADER_SIZE 2048
+#define LOG_PAGES ((LOG_SECTOR_SIZE - LOG_HEADER_SIZE) / LOGGER_PAGE_SIZE) // 504 per sector
+#define LOG_SPARE_MARGIN 16 // pages left in the active sector when the other one is erased
+#define LOG_COMMIT_MARK 0xA5
+#define LOG_ERASED 0xFFFFFFFF
+
+struct SectorHeader
+{
+    uint32_t magic;
+    uint32_t sequence;            // incremented on every rotation
+    uint32_t index[LOG_PAGES];    // time of the first record in each page
+};
+
+struct LogPage
+{
+    LogRecord records[LOGGER_PAGE_RECORDS];
+    uint32_t commit; // count | LOG_COMMIT_MARK << 8 | crc16 << 16, programmed last
+};
+
+static_assert(sizeof(LogRecord) == 12, "LogRecord must stay packed");
+static_assert(sizeof(LogPage) == LOGGER_PAGE_SIZE, "LogPage must fill one page");
+static_assert(sizeof(SectorHeader) <= LOG_HEADER_SIZE, "sector index does not fit the header");
+
+static const uintptr_t sectorBase[LOG_SECTORS] = {0x08020000, 0x08040000};
+
+static bool available = false;
+static uint8_t active = 0;      // sector being written
+static uint16_t nextPage = 0;   // next page to program in the active sector
+static uint32_t stored = 0;     // committed records in flash
+static bool spareErased = false; // the other sector is blank, ready for rotate()
+
+static LogRecord batch[LOGGER_PAGE_RECORDS];
+static uint8_t batchCount = 0;
+
+static uint32_t newestTime = 0; // of the last record, the floor for the next
+
+static uint32_t lastAddMs[SENSOR_MAX];
+static uint8_t haveAdded = 0; // bitmask per sensor
+
+static const SectorHeader *header(uint8_t s)
+{
+    return (const SectorHeader *)sectorBase[s];
+}
+
+static const LogPage *page(uint8_t s, uint16_t p)
+{
+    return (const LogPage *)(sectorBase[s] + LOG_HEADER_SIZE + (uint32_t)p * LOGGER_PAGE_SIZE);
+}
+
+// --- Internal flash backend ---
+
+#ifdef LOGGER_FLASH
+static const uint32_t sectorId[LOG_SECTORS] = {FLASH_SECTOR_5, FLASH_SECTOR_6};
+
+static void flashUnlock()
+{
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+}
+
+// Blocks for about a second: code runs from flash, so interrupts stall too
+static bool flashErase(uint8_t s)
+{
+    FLASH_EraseInitTypeDef erase = {};
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = sectorId[s];
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    uint32_t bad = 0;
+    flashUnlock();
+    bool ok = HAL_FLASHEx_Erase(&erase, &bad) == HAL_OK;
+    HAL_FLASH_Lock();
+    return ok;
+}
+
+static bool flashProgram(uintptr_t addr, const uint32_t *words, size_t count)
+{
+    bool ok = true;
+    flashUnlock();
+    for (size_t i = 0; i < count && ok; i++)
+    {
+        ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t)(addr + i * 4), words[i]) == HAL_OK;
+    }
+    HAL_FLASH_Lock();
+    return ok;
+}
+
+static bool programWord(uintptr_t addr, uint32_t value)
+{
+    return flashProgram(addr, &value, 1);
+}
+
+static bool blank(uintptr_t addr, size_t bytes)
+{
+    const uint32_t *w = (const uint32_t *)addr;
+    for (size_t i = 0; i < bytes / 4; i++)
+    {
+        if (w[i] != LOG_ERASED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool pageBlank(const LogPage *pg)
+{
+    return blank((uintptr_t)pg, LOGGER_PAGE_SIZE);
+}
+#endif
+
+// Programs the header of an erased sector
+static bool startSector(uint8_t s, uint32_t sequence)
+{
+#ifdef LOGGER_FLASH
+    const uint32_t words[2] = {LOG_MAGIC, sequence};
+    return flashProgram(sectorBase[s], words, 2);
+#else
+    (void)s;
+    (void)sequence;
+    return false;
+#endif
+}
+
+static bool formatSector(uint8_t s, uint32_t sequence)
+{
+#ifdef LOGGER_FLASH
+    if (!flashErase(s))
+    {
+        return false;
+    }
+#endif
+    return startSector(s, sequence);
+}
+
+// --- Page helpers ---
+
+static bool sectorValid(uint8_t s)
+{
+    return header(s)->magic == LOG_MAGIC && header(s)->sequence != LOG_ERASED;
+}
+
+static uint8_t pageCount(const LogPage *pg)
+{
+    uint32_t commit = pg->commit;
+    uint8_t count = (uint8_t)commit;
+    if (((commit >> 8) & 0xFF) != LOG_COMMIT_MARK || count == 0 || count > LOGGER_PAGE_RECORDS)
+    {
+        return 0;
+    }
+    const uint16_t crc = telemetryCrc16((const uint8_t *)pg->records, count * sizeof(LogRecord));
+    return (uint16_t)(commit >> 16) == crc ? count : 0;
+}
+
+// Index slots are programmed in order, so the used ones form a prefix
+static uint16_t usedPages(uint8_t s)
+{
+    const uint32_t *index = header(s)->index;
+    uint16_t lo = 0;
+    uint16_t hi = LOG_PAGES;
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        if (index[mid] != LOG_ERASED)
+        {
+            lo = (uint16_t)(mid + 1);
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Sectors in time order: oldest first. Returns how many are in use.
+static uint8_t sectorOrder(uint8_t order[LOG_SECTORS])
+{
+    uint8_t n = 0;
+    uint8_t other = (uint8_t)(1 - active);
+    if (sectorValid(other) && header(other)->sequence < header(active)->sequence)
+    {
+        order[n++] = other;
+    }
+    if (sectorValid(active))
+    {
+        order[n++] = active;
+    }
+    return n;
+}
+
+static uint32_t sectorRecords(uint8_t s)
+{
+    uint32_t total = 0;
+    for (uint16_t p = 0, used = usedPages(s); p < used; p++)
+    {
+        total += pageCount(page(s, p));
+    }
+    return total;
+}
+
+// Newest committed record of sector s, false if it holds none
+static bool sectorNewest(uint8_t s, uint32_t &time)
+{
+    for (uint16_t p = usedPages(s); p-- > 0;)
+    {
+        uint8_t count = pageCount(page(s, p));
+        if (count != 0)
+        {
+            time = page(s, p)->records[count - 1].time;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool sectorOldest(uint8_t s, uint32_t &time)
+{
+    for (uint16_t p = 0, used = usedPages(s); p < used; p++)
+    {
+        if (pageCount(page(s, p)) != 0)
+        {
+            time = page(s, p)->records[0].time;
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- Log ---
+
+void loggerBegin()
+{
+    available = false;
+    batchCount = 0;
+    haveAdded = 0;
+    stored = 0;
+#ifdef LOGGER_FLASH
+    bool valid0 = sectorValid(0);
+    bool valid1 = sectorValid(1);
+    if (!valid0 && !valid1)
+    {
+        // First boot, or the area held something else
+        // (sector 1 is erased by loggerService() before the log rotates into it)
+        if (!formatSector(0, 1))
+        {
+            return;
+        }
+        active = 0;
+    }
+    else if (valid0 && valid1)
+    {
+        active = header(1)->sequence > header(0)->sequence ? 1 : 0;
+    }
+    else
+    {
+        active = valid1 ? 1 : 0;
+    }
+
+    // A page programmed without its index entry (reset in between) is
+    // closed with a copy of the previous index and never reused
+    nextPage = usedPages(active);
+    while (nextPage < LOG_PAGES && !pageBlank(page(active, nextPage)))
+    {
+        uint32_t prev = nextPage ? header(active)->index[nextPage - 1] : 0;
+        programWord((uintptr_t)&header(active)->index[nextPage], prev);
+        nextPage++;
+    }
+    uint8_t other = (uint8_t)(1 - active);
+    spareErased = !sectorValid(other) && blank(sectorBase[other], LOG_SECTOR_SIZE);
+
+    uint8_t order[LOG_SECTORS];
+    uint8_t n = sectorOrder(order);
+    for (uint8_t i = 0; i < n; i++)
+    {
+        stored += sectorRecords(order[i]);
+    }
+    uint32_t newest;
+    for (uint8_t i = n; i-- > 0;)
+    {
+        if (sectorNewest(order[i], newest))
+        {
+            newestTime = newest;
+            break;
+        }
+    }
+    available = true;
+#endif
+}
+
+uint32_t loggerNow()
+{
+    uint32_t now = rtcTimeSeconds();
+    return now > newestTime ? now : newestTime;
+}
+
+bool loggerServiceDue()
+{
+    return available && !spareErased && nextPage >= LOG_PAGES - LOG_SPARE_MARGIN;
+}
+
+void loggerService()
+{
+    if (!loggerServiceDue())
+    {
+        return;
+    }
+    uint8_t other = (uint8_t)(1 - active);
+    uint32_t dropped = sectorValid(other) ? sectorRecords(other) : 0;
+#ifdef LOGGER_FLASH
+    if (!flashErase(other))
+    {
+        available = false;
+        return;
+    }
+#endif
+    stored -= dropped;
+    spareErased = true;
+}
+
+// The other sector, erased ahead by loggerService(), becomes the active
+// one. Never erases: that would stall the sample path for a second.
+static bool rotate()
+{
+    if (!spareErased)
+    {
+        return false; // The batch waits in RAM for loggerService()
+    }
+    uint8_t other = (uint8_t)(1 - active);
+    if (!startSector(other, header(active)->sequence + 1))
+    {
+        available = false;
+        return false;
+    }
+    spareErased = false;
+    active = other;
+    nextPage = 0;
+    return true;
+}
+
+void loggerFlush()
+{
+    if (!available || batchCount == 0)
+    {
+        return;
+    }
+    if (nextPage >= LOG_PAGES && !rotate())
+    {
+        return;
+    }
+#ifdef LOGGER_FLASH
+    const LogPage *pg = page(active, nextPage);
+    const uintptr_t addr = (uintptr_t)pg;
+    const size_t bytes = batchCount * sizeof(LogRecord);
+    uint32_t words[LOGGER_PAGE_SIZE / 4];
+    memset(words, 0xFF, sizeof(words));
+    memcpy(words, batch, bytes);
+    uint32_t commit = batchCount | ((uint32_t)LOG_COMMIT_MARK << 8) |
+                      ((uint32_t)telemetryCrc16((const uint8_t *)batch, bytes) << 16);
+    // Records, then the commit word, then the index entry
+    uint32_t t = profilerStart();
+    bool ok = flashProgram(addr, words, (bytes + 3) / 4) &&
+              programWord(addr + offsetof(LogPage, commit), commit);
+    programWord((uintptr_t)&header(active)->index[nextPage], batch[0].time);
+    profilerStop(PROF_LOGGER, t);
+    nextPage++;
+    if (ok)
+    {
+        stored += batchCount;
+    }
+#endif
+    batchCount = 0;
+}
+
+bool loggerAdd(const SensorReading &reading, uint8_t sensor, uint32_t nowMs, uint32_t timeS)
+{
+    if (sensor >= SENSOR_MAX)
+    {
+        return false;
+    }
+    const uint8_t bit = (uint8_t)(1u << sensor);
+    if (!(haveAdded & bit))
+    {
+        haveAdded |= bit;
+        lastAddMs[sensor] = nowMs;
+    }
+    else if ((nowMs - lastAddMs[sensor]) < LOGGER_INTERVAL_MS)
+    {
+        return false;
+    }
+    else
+    {
+        // Fixed-rate decimation clock, re-anchored after a long gap
+        lastAddMs[sensor] += LOGGER_INTERVAL_MS;
+        if ((nowMs - lastAddMs[sensor]) >= LOGGER_INTERVAL_MS)
+        {
+            lastAddMs[sensor] = nowMs;
+        }
+    }
+
+    if (batchCount == LOGGER_PAGE_RECORDS)
+    {
+        return false; // Full and still waiting for the spare sector
+    }
+    LogRecord &r = batch[batchCount++];
+    r.time = timeS > newestTime ? timeS : newestTime;
+    newestTime = r.time;
+    r.temperature = (int16_t)reading.temperature;
+    r.humidity = (uint16_t)humidityCenti(reading.humidity);
+    uint32_t pa = pressurePa(reading.pressure);
+    r.pressure[0] = (uint8_t)pa;
+    r.pressure[1] = (uint8_t)(pa >> 8);
+    r.pressure[2] = (uint8_t)(pa >> 16);
+    r.sensor = sensor;
+
+    if (batchCount == LOGGER_PAGE_RECORDS)
+    {
+        loggerFlush();
+        if (!available)
+        {
+            batchCount = 0; // dropped, there is nowhere to put them
+        }
+    }
+    return true;
+}
+
+void loggerErase()
+{
+    batchCount = 0;
+    stored = 0;
+    newestTime = 0; // an empty log may start over at an earlier time
+    if (!available)
+    {
+        return;
+    }
+    uint32_t sequence = header(active)->sequence + 1;
+#ifdef LOGGER_FLASH
+    spareErased = flashErase((uint8_t)(1 - active));
+#endif
+    if (!formatSector(active, sequence))
+    {
+        available = false;
+        return;
+    }
+    nextPage = 0;
+}
+
+uint32_t loggerCount()
+{
+    return stored + batchCount;
+}
+
+bool loggerSpan(uint32_t &oldest, uint32_t &newest)
+{
+    bool found = false;
+    uint8_t order[LOG_SECTORS];
+    uint8_t n = available ? sectorOrder(order) : 0;
+    for (uint8_t i = 0; i < n && !found; i++)
+    {
+        found = sectorOldest(order[i], oldest);
+    }
+    if (!found)
+    {
+        if (batchCount == 0)
+        {
+            return false;
+        }
+        oldest = batch[0].time;
+    }
+    if (batchCount != 0)
+    {
+        newest = batch[batchCount - 1].time;
+        return true;
+    }
+    for (uint8_t i = n; i-- > 0;)
+    {
+        if (sectorNewest(order[i], newest))
+        {
+            return true;
+        }
+    }
+    return found;
+}
+
+// Batches records into dump frames
+struct DumpWriter
+{
+    Print &out;
+    uint8_t pkt[2 + LOGGER_DUMP_BATCH * sizeof(LogRecord) + 2];
+    uint8_t count;
+    uint32_t sent;
+
+    void add(const LogRecord &r)
+    {
+        memcpy(&pkt[2 + count * sizeof(LogRecord)], &r, sizeof(LogRecord));
+        if (++count == LOGGER_DUMP_BATCH)
+        {
+            finish();
+        }
+    }
+
+    void finish()
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        pkt[0] = TELEMETRY_PKT_LOG;
+        pkt[1] = count;
+        telemetryWriteFrame(out, pkt, 2 + count * sizeof(LogRecord) + 2);
+        sent += count;
+        count = 0;
+    }
+};
+
+// Last page whose first record is <= since, found in the index
+static uint16_t seekPage(uint8_t s, uint16_t used, uint32_t since)
+{
+    const uint32_t *index = header(s)->index;
+    uint16_t lo = 0;
+    uint16_t hi = used;
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        if (index[mid] <= since)
+        {
+            lo = (uint16_t)(mid + 1);
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo ? (uint16_t)(lo - 1) : 0;
+}
+
+uint32_t loggerDump(Print &out, uint32_t since)
+{
+    static_assert(sizeof(DumpWriter::pkt) <= TELEMETRY_MAX_FRAME - 2, "dump frame too large");
+    DumpWriter writer = {out, {}, 0, 0};
+    uint8_t order[LOG_SECTORS];
+    uint8_t n = available ? sectorOrder(order) : 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint8_t s = order[i];
+        uint16_t used = usedPages(s);
+        for (uint16_t p = seekPage(s, used, since); p < used; p++)
+        {
+            const LogPage *pg = page(s, p);
+            for (uint8_t k = 0, count = pageCount(pg); k < count; k++)
+            {
+                if (pg->records[k].time >= since)
+                {
+                    writer.add(pg->records[k]);
+                }
+            }
+        }
+    }
+    for (uint8_t k = 0; k < batchCount; k++)
+    {
+        if (batch[k].time >= since)
+        {
+            writer.add(batch[k]);
+        }
+    }
+    writer.finish();
+    return writer.sent;
+}
@@ -1,294 +1,1132 @@
 #include <Arduino.h>
 #include <Wire.h>
-#include <Adafruit_BME280.h>
-#include <Adafruit_Sensor.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SH110X.h>
-
-#define SCREEN_WIDTH 128
-#define SCREEN_HEIGHT 64
-#define OLED_RESET -1
-#define BME_ADDR 0x76
+#include "acquisition.h"
+#include "scheduler.h"
+#include "oled_renderer.h"
+#include "oled_transport.h"
+#include "i2c_bus.h"
+#include "telemetry.h"
+#include "telemetry_writer.h"
+#include "sampler.h"
+#include "settings.h"
+#include "console.h"
+#include "history.h"
+#include "logger.h"
+#include "power.h"
+#include "button.h"
+#include "sensors.h"
+#include "profiler.h"
+#include "trend_graph.h"
+#include "filter.h"
+#include "rtc_time.h"
+#include "heap_guard.h"
+#include "ui_pages.h"
+#include "status_pages.h"
+#include "derived.h"
+#ifdef USE_FREERTOS
+#include <STM32FreeRTOS.h>
+#include "spsc_queue.h"
+#endif
+
+#define BME_ADDR 0x76     // Primary sensor; a second one may sit at 0x77
+#define BME_ADDR_ALT 0x77
+#define OLED_ADDR 0x3C
 #define BUTTON_PIN PA0
+#define SERIAL_BAUD 115200 // Ignored by USB CDC, which always runs at full speed
 #define I2C_SDA PB7 // Define I2C SDA pin
 #define I2C_SCL PB6 // Define I2C SCL pin
+// Build with -D SENSOR_BUS2 to also scan I2C2 for sensors
+#define I2C2_SDA PB3
+#define I2C2_SCL PB10
+
+#define STRINGIFY(x) #x
+#define STR(x) STRINGIFY(x)
+
+// --- Static Screens: rendered by the compiler, shown with one copy ---
+constexpr OledImage screenBmeNotFound = oledScreen(false,
+                                                   oledLine(0, "BME280 Not Found!"),
+                                                   oledLine(2, "Check Wiring:"),
+                                                   oledLine(4, "SDA=PB7, SCL=PB6"),
+                                                   oledLine(6, "BME280 @ " STR(BME_ADDR)));
+constexpr OledImage screenReady = oledScreen(false, oledLine(3, "Ready!"));
+constexpr OledImage screenBye = oledScreen(false, oledLine(3, "Bye ;)"));
+constexpr OledImage screenHello = oledScreen(false, oledLine(3, "Hello ;P"));
+constexpr OledImage screenSensorError = oledScreen(false,
+                                                   oledLine(2, "BME Sensor Error!"),
+                                                   oledLine(4, "Check Connection"));
 
-// --- Debounce Variables ---
-volatile bool buttonPressedFlag = false; // Flag set by ISR
-unsigned long lastDebounceTime = 0;      // Last time the output pin was toggled
-unsigned long debounceDelay = 50;        // Debounce time in milliseconds
+// --- Task Timing ---
+#define HEARTBEAT_PERIOD_MS 1000 // LED blink rate, independent of the sample rate
+#define HEARTBEAT_ON_MS 50       // LED on-time per blink
+#define DISPLAY_REFRESH_MS 200   // Fastest screen refresh, fast profiles sample quicker
+#define CONSOLE_POLL_MS 10       // Serial command input check
+#define CONSOLE_DRAIN_MS 50      // Longest wait for queued output before a console reply
+#define SPLASH_MS 500            // "Bye"/"Hello" message duration
+#define DISPLAY_WAKE_MS 100      // Settling time before a fallback display re-init
+#define OLED_POLL_US 500         // Flush progress check while a DMA page is in flight
+#define PROBE_RETRY_MS 1000      // Retry period for devices missing at boot
+#define HEALTH_REPORT_MS 10000   // I2C health telemetry, sent only when it changed
+#ifndef BOOT_SPLASH_MS
+#define BOOT_SPLASH_MS 0 // "Ready!" splash after boot, 0 = straight to the readings
+#endif
+#ifndef BACKGROUND_LOG_MS
+#define BACKGROUND_LOG_MS 60000 // History sample period with the screen off, 0 = none
+#endif
 
 // --- State Variables ---
 bool screen_on = true; // Let's use positive logic: screen_on = true means display is active
+bool displayReady = false; // Panel initialised; stays false while it is missing
+bool sensorReady = false;  // At least one BME280 calibrated and configured
+uint8_t telemetryPending = 0; // Sensors with a reading not yet sent
+
+// Screen transitions that used to block in delay() are now timed steps
+enum UiState
+{
+    UI_ACTIVE,      // Showing sensor data
+    UI_BYE,         // "Bye" splash, then blank
+    UI_WAKING,      // Switching the panel back on
+    UI_REINIT,      // Panel did not answer DISPLAYON, full begin() after settling
+    UI_HELLO,       // "Hello" splash, then sensor data
+    UI_MESSAGE,     // Short notice (e.g. new profile), then sensor data
+    UI_OFF          // Screen off
+};
+UiState uiState = UI_ACTIVE;
 
-Adafruit_BME280 bme;
-// Use SH1106G for the 1.3" OLED
-Adafruit_SH1106G display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// --- Task Ids ---
+int buttonTaskId = -1;
+int sampleTaskId = -1;
+int displayTaskId = -1;
+int telemetryTaskId = -1;
+int heartbeatTaskId = -1;
+int consoleTaskId = -1;
+int uiTaskId = -1;
+int oledTaskId = -1;
+int backgroundTaskId = -1;
+int probeTaskId = -1;
+int busTaskId = -1;
+int settingsTaskId = -1;
+int logTaskId = -1;
 
-// --- Minimal ISR ---
-void handleButtonInterrupt()
+#ifdef USE_FREERTOS
+// --- FreeRTOS variant: acquisition, telemetry and UI run as prioritised tasks ---
+// The cooperative scheduler still drives the UI side (button, screen,
+// console, ...) inside the lowest-priority task. Sampling and the serial
+// output leave it and run on their own, so UI work can delay neither.
+#define ACQ_PRIORITY (tskIDLE_PRIORITY + 3)
+#define TELEMETRY_PRIORITY (tskIDLE_PRIORITY + 2)
+#define UI_PRIORITY (tskIDLE_PRIORITY + 1)
+#define ACQ_STACK_WORDS 512
+#define TELEMETRY_STACK_WORDS 512
+#define UI_STACK_WORDS 1024
+#define SAMPLE_QUEUE_LEN 16
+
+// A reading handed from acquisition to telemetry/logging by value
+struct SampleRecord
 {
-    buttonPressedFlag = true;
+    SensorReading reading;
+    uint32_t ms;
+    SampleStamp stamp;
+    uint8_t sensor;
 };
+SpscQueue<SampleRecord, SAMPLE_QUEUE_LEN> sampleQueue;
+
+TaskHandle_t acquisitionHandle = nullptr;
+TaskHandle_t telemetryHandle = nullptr;
+TaskHandle_t uiHandle = nullptr;
+SemaphoreHandle_t busMutex;  // I2C buses, the sensor registry and the sampler
+SemaphoreHandle_t dataMutex; // History, flash log, filter and derived state
+volatile bool samplingEnabled = false;
+#endif
 
-// Helper function to display centered text
-void displayCenteredText(const char *text, int y)
-{
-    int16_t x1, y1;
-    uint16_t w, h;
-    display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h); // Calculate bounds
-    int x = (SCREEN_WIDTH - w) / 2;
-    display.setCursor(x, y);
-    display.print(text);
-}
-
-void printSensorData(float pressure, float temperature, float humidity)
-{
-    display.clearDisplay();
-    display.setTextColor(SH110X_WHITE);
-    display.setTextSize(1);
-    display.drawRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SH110X_WHITE);
-    display.setCursor(10, 10);
-    display.print("Press: ");
-    display.print(pressure, 2);
-    display.println(" mBar");
-    display.setCursor(10, 30);
-    display.print("Temp: ");
-    display.print(temperature, 1);
-    display.println(" C");
-    display.setCursor(10, 50);
-    display.print("Hum: ");
-    display.print(humidity, 1);
-    display.println(" %");
-    display.display();
+// Without an RTOS there is one thread of execution and nothing to lock
+void busLock()
+{
+#ifdef USE_FREERTOS
+    xSemaphoreTake(busMutex, portMAX_DELAY);
+#endif
 }
 
-void setup()
+void busUnlock()
 {
-    pinMode(PC13, OUTPUT);
-    pinMode(BUTTON_PIN, INPUT_PULLUP);
+#ifdef USE_FREERTOS
+    xSemaphoreGive(busMutex);
+#endif
+}
 
-    digitalWrite(PC13, HIGH); // Turn off built-in LED initially
+void dataLock()
+{
+#ifdef USE_FREERTOS
+    xSemaphoreTake(dataMutex, portMAX_DELAY);
+#endif
+}
 
-    Serial.begin(9600);
-    // Initialize Wire *before* display.begin()
-    Wire.begin(); // Use default SDA/SCL pins defined by the board variant (PB7/PB6 for Blackpill)
+void dataUnlock()
+{
+#ifdef USE_FREERTOS
+    xSemaphoreGive(dataMutex);
+#endif
+}
+
+// Starts or stops the sensor state machine, wherever it runs
+void enableSampling(bool on)
+{
+#ifdef USE_FREERTOS
+    samplingEnabled = on;
+    if (on && acquisitionHandle)
+    {
+        xTaskNotifyGive(acquisitionHandle);
+    }
+#else
+    schedulerEnable(sampleTaskId, on);
+    if (on)
+    {
+        schedulerSignal(sampleTaskId);
+    }
+#endif
+}
 
-    Serial.println("Starting Initialization...");
-    Serial.println("--------------------------");
+// Shared I2C bus, clocked at the fastest rate every device accepts
+I2cBus mainBus;
+I2cDevice busDevices[] = {
+    {"BME280", BME_ADDR, i2cProbeBme280, 0},
+    {"BME280", BME_ADDR_ALT, i2cProbeBme280, 0},
+    {"SH1106", OLED_ADDR, i2cProbeSh1106, 0},
+};
 
-    // Initialize Display - Retry Loop
-    Serial.println("Initializing Display...");
-    while (!display.begin(0x3C, true)) // Address 0x3C, init i2c if not yet started
+#ifdef SENSOR_BUS2
+// Second I2C peripheral, sensors only
+TwoWire Wire2(I2C2_SDA, I2C2_SCL);
+I2cBus sensorBus;
+I2cDevice sensorBusDevices[] = {
+    {"BME280", BME_ADDR, i2cProbeBme280, 0},
+    {"BME280", BME_ADDR_ALT, i2cProbeBme280, 0},
+};
+#endif
+
+// --- Button events arrive from the debounce timer interrupt ---
+void handleButtonEvent()
+{
+    schedulerSignal(buttonTaskId);
+#ifdef USE_FREERTOS
+    if (uiHandle)
     {
-        Serial.println(F("SH1106 connection failed."));
-        Serial.print(F("Expecting SCL=PB"));
-        Serial.print(PIN_WIRE_SCL); // Use defined pin number from variant
-        Serial.print(F(", SDA=PB"));
-        Serial.print(PIN_WIRE_SDA);
-        Serial.println(F(". Check wiring."));
-        Serial.println(F("Retrying in 1 second..."));
-        digitalWrite(PC13, LOW);
-        delay(500);
-        digitalWrite(PC13, HIGH);
-        delay(500);
-    }
-    Serial.println("Display Initialized OK.");
-    display.display(); // Show initial buffer (might be garbage)
-    delay(100);
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SH110X_WHITE);
-    displayCenteredText("Display OK", 28); // Use helper function
-    display.display();
-    delay(500); // Show message briefly
-    Serial.println("--------------------------");
-
-    // --- Initialize BME280 - Retry Loop ---
-    Serial.println("Initializing BME280 Sensor...");
-    display.clearDisplay();
-    displayCenteredText("Finding BME280...", 28); // Use helper function
-    display.display();
-    while (!bme.begin(BME_ADDR, &Wire)) // Pass Wire object explicitly
-    {
-        Serial.println(F("BME280 connection failed."));
-        Serial.print(F("Expecting SCL=PB"));
-        Serial.print(PIN_WIRE_SCL);
-        Serial.print(F(", SDA=PB"));
-        Serial.print(PIN_WIRE_SDA);
-        Serial.print(F(" (Address 0x"));
-        Serial.print(BME_ADDR, HEX);
-        Serial.println(F("). Check wiring."));
-        Serial.println(F("Retrying in 1 second..."));
-
-        display.clearDisplay();
-        display.setTextSize(1);
-        display.setTextColor(SH110X_WHITE);
-        displayCenteredText("BME280 Not Found!", 5);
-        displayCenteredText("Check Wiring:", 20);
-        displayCenteredText("SDA=PB7, SCL=PB6", 35);
-        displayCenteredText("Retrying...", 50);
-        display.display();
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(uiHandle, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+#endif
+}
 
-        digitalWrite(PC13, LOW);
-        delay(500);
-        digitalWrite(PC13, HIGH);
-        delay(500);
-    }
-    // --- BME280 Initialized OK ---
-    Serial.println("BME280 Found!");
-    display.clearDisplay();
-    char bmeOkMsg[20]; // Buffer for the message
-    snprintf(bmeOkMsg, sizeof(bmeOkMsg), "BME280 OK (0x%X)", BME_ADDR);
-    displayCenteredText(bmeOkMsg, 28); // Use helper function
-    display.display();
-    delay(1000); // Show message
-    Serial.println("--------------------------");
+// Starts an (asynchronous) flush and lets the oled task drive it
+void refreshDisplay()
+{
+    if (!displayReady)
+    {
+        return;
+    }
+    uint32_t t = profilerStart();
+    oledRendererFlush();
+    profilerStop(PROF_FLUSH, t);
+    schedulerSignal(oledTaskId);
+}
 
-    // --- Attach Interrupt ---
-    Serial.println("Attaching button interrupt...");
-    attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), handleButtonInterrupt, FALLING);
-    Serial.println("Interrupt attached.");
-    Serial.println("--------------------------");
+// --- OLED Task: feeds the next dirty page to the transport ---
+void oledTask(uint32_t now)
+{
+    (void)now;
+    if (oledRendererPoll())
+    {
+        schedulerWakeIn(oledTaskId, OLED_POLL_US);
+    }
+}
 
-    // --- Ready Message ---
-    display.clearDisplay();
-    displayCenteredText("Ready!", 28); // Use helper function
-    display.display();
-    delay(1000);            // Show message
-    display.clearDisplay(); // Clear screen before entering loop
-    display.display();      // Send clear command
+// Wakes the display task, from any thread
+void signalDisplay()
+{
+    schedulerSignal(displayTaskId);
+#ifdef USE_FREERTOS
+    if (uiHandle)
+    {
+        xTaskNotifyGive(uiHandle);
+    }
+#endif
+}
 
-    Serial.println("Setup Complete. Entering main loop.");
-    Serial.println("==========================");
+// Shows a static screen, used for the screen transitions
+void showSplash(const OledImage &screen)
+{
+    oledRendererShowImage(screen);
+    refreshDisplay();
 }
 
-void loop()
+// Shows a centred one-line message built at runtime
+void showMessage(const char *text)
+{
+    oledRendererClear();
+    oledRendererCenteredText(3, text);
+    refreshDisplay();
+}
+
+// Short press: toggles the screen
+void handleShortPress()
+{
+    if (!displayReady)
+    {
+        return; // Nothing to switch until the panel has been found
+    }
+    if (uiState == UI_ACTIVE) // Turning OFF
+    {
+        telemetryWriter.println("Screen turning OFF");
+        screen_on = false;
+        enableSampling(false);                 // Sampling only runs with the screen on
+        schedulerEnable(consoleTaskId, false); // USB is down while in STOP anyway
+        showSplash(screenBye);
+        uiState = UI_BYE;
+        schedulerWakeIn(uiTaskId, SPLASH_MS * 1000UL);
+    }
+    else if (uiState == UI_OFF) // Turning ON
+    {
+        telemetryWriter.println("Screen turning ON");
+        uiState = UI_WAKING;
+        schedulerSignal(uiTaskId);
+    }
+    // Presses during a transition are ignored
+}
+
+// Long press: steps to the next sampling profile and keeps it
+void handleLongPress()
+{
+    if (uiState != UI_ACTIVE)
+    {
+        return;
+    }
+    SamplingProfileId next = (SamplingProfileId)((samplerProfile() + 1) % PROFILE_COUNT);
+    if (!samplerSetProfile(next))
+    {
+        telemetryWriter.println(F("Failed to apply the sampling profile!"));
+        return;
+    }
+    settings.profile = next;
+    settingsMarkDirty();
+    telemetryWriter.print(F("Sampling profile: "));
+    telemetryWriter.println(samplingProfiles[next].name);
+    showMessage(samplingProfiles[next].name);
+    uiState = UI_MESSAGE;
+    schedulerWakeIn(uiTaskId, SPLASH_MS * 1000UL);
+}
+
+// Double press: each sensor's readings, the history graphs, then the status pages
+void showNextScreen()
 {
-    // --- Button Debounce Logic ---
-    if (buttonPressedFlag)
+    pagesNext();
+    telemetryWriter.print(F("Page: "));
+    telemetryWriter.println(pagesName());
+    schedulerSignal(displayTaskId);
+}
+
+// --- Button Task: dispatches the debounced gestures ---
+void buttonTask(uint32_t now)
+{
+    (void)now;
+    ButtonEvent event;
+    while (buttonPoll(event))
     {
-        if ((millis() - lastDebounceTime) > debounceDelay)
+        switch (event)
         {
-            Serial.println("Button Pressed!");
-            lastDebounceTime = millis();
+        case BUTTON_SHORT:
+            telemetryWriter.println("Button Pressed!");
+            handleShortPress();
+            break;
+        case BUTTON_LONG:
+            telemetryWriter.println("Button Long Press!");
+            handleLongPress();
+            break;
+        case BUTTON_DOUBLE:
+            telemetryWriter.println("Button Double Press!");
+            showNextScreen();
+            break;
+        }
+    }
+}
 
-            // Store the *intended* next state
-            bool next_screen_state = !screen_on;
+// Resumes sampling and shows the wake-up splash once the panel is lit
+void resumeScreen()
+{
+    showSplash(screenHello);
+    screen_on = true;
+    schedulerEnable(backgroundTaskId, false);
+    if (!samplerSetProfile(samplerProfile())) // Wake the sensor from sleep
+    {
+        telemetryWriter.println(F("Failed to apply the sampling profile!"));
+    }
+    schedulerEnable(consoleTaskId, true);
+    enableSampling(true);
+    uiState = UI_HELLO;
+    schedulerWakeIn(uiTaskId, SPLASH_MS * 1000UL);
+}
 
-            if (next_screen_state == false) // Turning OFF
-            {
-                Serial.println("Screen turning OFF");
-
-                // --- Display "Bye" message ---
-                display.clearDisplay();
-                display.setTextSize(1);             // Ensure text size is set
-                display.setTextColor(SH110X_WHITE); // Ensure color is set
-                displayCenteredText("Bye ;)", 28);  // Display centered message
-                display.display();
-                delay(500); // Show message for 0.5 seconds
-                // --- End "Bye" message ---
-
-                // 1. Clear the display buffer again (good practice before power off)
-                display.clearDisplay();
-                // 2. Send the clear command to the physical display
-                display.display();
-                // 3. Wait a short moment for the command to process before cutting power
-                delay(50); // Keep short delay
-            }
-            else // Turning ON
+// --- UI Task: advances the timed steps of a screen transition ---
+void uiTask(uint32_t now)
+{
+    (void)now;
+    switch (uiState)
+    {
+    case UI_BYE:
+        // Clear the panel before going dark
+        oledRendererClear();
+        oledRendererFlushWait();
+        if (!oledRendererSetPower(false)) // Panel sleep, RAM is kept
+        {
+            telemetryWriter.println("Display did not ACK DISPLAYOFF!");
+        }
+        for (uint8_t i = 0; i < sensorCount(); i++)
+        {
+            if (sensorAt(i).ready && !sensorAt(i).bme.sleep())
             {
-                Serial.println("Screen turning ON");
-                // 2. Give power time to stabilize and display to wake up
-                delay(100); // Keep delay
-                // 3. Re-initialize the display (important after power cycle)
-                if (!display.begin(0x3C, true))
-                {
-                    Serial.println("Failed to re-init display after power on!");
-                    next_screen_state = false; // Force state back to off if re-init fails
-                }
-                else
-                {
-                    // --- Display "Hello" message ---
-                    display.clearDisplay();
-                    display.setTextSize(1);              // Ensure text size is set
-                    display.setTextColor(SH110X_WHITE);  // Ensure color is set
-                    displayCenteredText("Hello ;P", 28); // Display centered message
-                    display.display();
-                    delay(500); // Show message for 0.5 seconds
-                    // --- End "Hello" message ---
-
-                    // Clear display buffer before resuming normal operation
-                    display.clearDisplay();
-                    display.display();
-                }
+                telemetryWriter.println("Failed to put a BME280 to sleep!");
             }
+        }
+        digitalWrite(PC13, HIGH); // HIGH turns PC13 LED OFF on many boards
+        uiState = UI_OFF;
+        if (BACKGROUND_LOG_MS)
+        {
+            schedulerEnable(backgroundTaskId, true);
+            schedulerWakeIn(backgroundTaskId, BACKGROUND_LOG_MS * 1000UL);
+        }
+        break;
+
+    case UI_WAKING:
+        // Panel RAM and setup survived DISPLAYOFF: just light it again
+        if (oledRendererSetPower(true))
+        {
+            resumeScreen();
+            break;
+        }
+        telemetryWriter.println("Display not answering, re-initialising...");
+        uiState = UI_REINIT;
+        schedulerWakeIn(uiTaskId, DISPLAY_WAKE_MS * 1000UL);
+        break;
+
+    case UI_REINIT:
+        // Fallback: full init, as after a power cycle of the panel
+        if (!oledRendererBegin(&Wire, OLED_ADDR))
+        {
+            telemetryWriter.println("Failed to re-init display after power on!");
+            uiState = UI_OFF; // Force state back to off if re-init fails
+            break;
+        }
+        resumeScreen();
+        break;
+
+    case UI_HELLO:
+    case UI_MESSAGE:
+        // Clear display buffer before resuming normal operation
+        oledRendererClear();
+        refreshDisplay();
+        pagesInvalidate(); // The page comes back in full
+        uiState = UI_ACTIVE;
+        schedulerSignal(displayTaskId);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Advances the sampler; returns the mask of sensors with a fresh reading
+// and sets failed to those whose read failed
+uint8_t acquireSamples(uint32_t now, uint8_t &failed)
+{
+    oledTransportWaitIdle(); // The panel and the sensors share the bus
+    uint8_t wasValid = 0;
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        wasValid |= sensorAt(i).valid ? (1 << i) : 0;
+    }
+    uint8_t fresh = samplerPoll(now, failed);
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        if (fresh & (1 << i))
+        {
+            filterApply(i, sensorAt(i).reading); // Every output sees the smoothed value
+        }
+    }
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        // Only the visible page's sensor, and only a change worth showing
+        const Sensor &s = sensorAt(i);
+        if ((fresh & (1 << i)) && pagesWants(PAGE_IN_READING(i)) &&
+            filterReport(FILTER_OUT_DISPLAY, i, s.reading, s.readingMs) && pagesMark(PAGE_IN_READING(i)))
+        {
+            schedulerSignal(displayTaskId);
+        }
+    }
+    if (fresh)
+    {
+        schedulerSignal(heartbeatTaskId);
+    }
+    if (failed)
+    {
+        if (failed & wasValid)
+        {
+            telemetryWriter.println("Failed to read from BME sensor!");
+        }
+        schedulerSignal(busTaskId); // Recovery or reconnect may now be due
+        if (sensorsReady() == 0)
+        {
+            enableSampling(false); // All offline; busTask restarts it on a reconnect
+        }
+        if (pagesMark(failed)) // PAGE_IN_READING of each failed sensor
+        {
+            schedulerSignal(displayTaskId);
+        }
+        // Still blink LED even if sensor fails, shows MCU is running
+        schedulerSignal(heartbeatTaskId);
+    }
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        uint8_t bit = 1 << i;
+        if ((fresh | failed) & bit)
+        {
+            i2cBusRecordResult(*sensorAt(i).bus, !(failed & bit), telemetryWriter); // Slow down on repeated failures
+        }
+    }
+    return fresh;
+}
 
-            // Update the master state variable *after* actions are taken
-            screen_on = next_screen_state;
+// History follows the primary sensor at a fixed rate; the flash log takes
+// every sensor, but only readings that changed or are due for a heartbeat
+void recordSample(uint8_t sensor, const SensorReading &reading, uint32_t ms, const SampleStamp &stamp)
+{
+    if (sensor == 0 && historyAdd(reading, ms, stamp.seconds) && pagesMark(PAGE_IN_HISTORY))
+    {
+        signalDisplay();
+    }
+    // Decimated to LOGGER_INTERVAL_MS; a change it skips stays due for the next record
+    if (filterDue(FILTER_OUT_LOG, sensor, reading, ms) && loggerAdd(reading, sensor, ms, stamp.seconds))
+    {
+        filterReported(FILTER_OUT_LOG, sensor, reading, ms);
+    }
+    if (loggerServiceDue())
+    {
+        schedulerSignal(logTaskId); // The erase runs after everything else that is due
+#ifdef USE_FREERTOS
+        if (uiHandle)
+        {
+            xTaskNotifyGive(uiHandle);
         }
-        // Reset the interrupt flag regardless of debounce check
-        buttonPressedFlag = false;
+#endif
     }
+}
 
-    // --- Sensor Reading, Display Update, and Heartbeat ---
-    if (screen_on)
+// --- Sample Task: runs the profile's trigger/status-poll state machine ---
+void sampleTask(uint32_t now)
+{
+    uint8_t failed;
+    uint8_t fresh = acquireSamples(now, failed);
+    uint8_t report = 0;
+    for (uint8_t i = 0; i < sensorCount(); i++)
     {
-        // Read sensor values
-        float temperature = bme.readTemperature();
-        float humidity = bme.readHumidity();
-        float pressure = bme.readPressure() / 100.0F; // Convert Pa to mBar
-        float altitude = bme.readAltitude(1013.25);
+        const Sensor &sensor = sensorAt(i);
+        if (fresh & (1 << i))
+        {
+            recordSample(i, sensor.reading, sensor.readingMs, sensor.stamp);
+            report |= filterReport(FILTER_OUT_TELEMETRY, i, sensor.reading, sensor.readingMs) ? (1 << i) : 0;
+        }
+    }
+    if (report)
+    {
+        telemetryPending |= report;
+        schedulerSignal(telemetryTaskId);
+    }
+    schedulerWakeAt(sampleTaskId, samplerNextPollUs());
+}
 
-        // Check for valid readings
-        if (isnan(temperature) || isnan(humidity) || isnan(pressure))
+// --- Background Task: sparse forced samples into the history while the screen is off ---
+void backgroundTask(uint32_t now)
+{
+    static bool converting = false;
+    static uint32_t cycleStart = 0;
+    Sensor &primary = sensorAt(0);
+    if (!converting)
+    {
+        // The weather profile is the lowest-power single-shot configuration
+        cycleStart = now;
+        if (primary.ready && primary.bme.configure(samplingProfiles[PROFILE_WEATHER].config) &&
+            primary.bme.startForced())
         {
-            Serial.println("Failed to read from BME sensor!");
-            // Display sensor error message
-            display.clearDisplay();
-            display.setTextSize(1);
-            display.setTextColor(SH110X_WHITE);
-            displayCenteredText("BME Sensor Error!", 20);
-            displayCenteredText("Check Connection", 35);
-            display.display();
-            // Still blink LED even if sensor fails, shows MCU is running
+            converting = true;
+            schedulerWakeIn(backgroundTaskId, primary.bme.measurementTimeUs());
+            return;
         }
-        else
+    }
+    else
+    {
+        // Forced mode drops back to sleep by itself once the conversion is done
+        converting = false;
+        SensorReading reading;
+        SampleStamp stamp;
+        samplerStamp(stamp);
+        if (primary.bme.read(reading))
         {
-            // Print to display
-            printSensorData(pressure, temperature, humidity);
+            recordSample(0, reading, millis(), stamp);
+        }
+    }
+    schedulerWakeAt(backgroundTaskId, cycleStart + BACKGROUND_LOG_MS * 1000UL);
+}
+
+// --- Screen pages ---
+bool renderSensorPage(uint8_t index, bool full)
+{
+    (void)full; // The renderer redraws its layout when something else was shown
+    const Sensor &sensor = sensorAt(index);
+    if (!sensorReady || !sensor.valid)
+    {
+        // Display sensor error message
+        oledRendererShowImage(sensorReady ? screenSensorError : screenBmeNotFound);
+        return true;
+    }
+    // Only the digits that changed since the last frame reach the panel
+    char tag[SENSOR_LABEL_LEN];
+    sensorLabel(index, tag, sizeof(tag));
+    oledRendererSensorScreen(sensor.reading, sensorCount() > 1 ? tag : nullptr);
+    return true;
+}
+
+bool sensorPageAvailable(uint8_t index)
+{
+    return index == 0 || index < sensorCount();
+}
+
+bool renderGraphPage(uint8_t channel, bool full)
+{
+    (void)full; // The graph redraws itself when it was not on screen
+    return trendGraphRender((HistoryChannel)channel);
+}
+
+void addPages()
+{
+    static const char *const sensorPages[SENSOR_MAX] = {"sensor 1", "sensor 2", "sensor 3", "sensor 4"};
+    for (uint8_t i = 0; i < SENSOR_MAX; i++)
+    {
+        pagesAdd(sensorPages[i], PAGE_IN_READING(i) | PAGE_IN_SENSORS, renderSensorPage, i, sensorPageAvailable);
+    }
+    pagesAdd("graph temp", PAGE_IN_HISTORY, renderGraphPage, HIST_TEMPERATURE);
+    pagesAdd("graph hum", PAGE_IN_HISTORY, renderGraphPage, HIST_HUMIDITY);
+    pagesAdd("graph press", PAGE_IN_HISTORY, renderGraphPage, HIST_PRESSURE);
+    pagesAdd("derived", PAGE_IN_READING(0) | PAGE_IN_SENSORS, statusPageDerived, 0, statusPageDerivedAvailable);
+    pagesAdd("stats", PAGE_IN_HISTORY, statusPageStats);
+    pagesAdd("health", PAGE_IN_TICK | PAGE_IN_SENSORS, statusPageHealth);
+    pagesAdd("profile", PAGE_IN_TICK, statusPageProfile);
+}
+
+// --- Display Task: render the latest sample ---
+void displayTask(uint32_t now)
+{
+    static uint32_t lastRefresh = 0;
+    if (!displayReady || uiState != UI_ACTIVE)
+    {
+        return; // A splash message owns the screen
+    }
+    uint32_t sinceUs = now - lastRefresh;
+    if (sinceUs < DISPLAY_REFRESH_MS * 1000UL)
+    {
+        // Fast profiles deliver samples quicker than the panel needs them
+        schedulerWakeAt(displayTaskId, lastRefresh + DISPLAY_REFRESH_MS * 1000UL);
+        return;
+    }
+    lastRefresh = now;
+    static uint32_t lastTick = 0;
+    if (pagesWants(PAGE_IN_TICK) && (now - lastTick) >= PAGE_TICK_MS * 1000UL)
+    {
+        lastTick = now;
+        pagesMark(PAGE_IN_TICK);
+    }
+    // Hidden pages are not drawn, the visible one only when its inputs changed
+    uint32_t t = profilerStart();
+    bool changed = pagesRender();
+    profilerStop(PROF_RENDER, t);
+    if (changed)
+    {
+        refreshDisplay();
+    }
+    if (pagesWants(PAGE_IN_TICK))
+    {
+        schedulerWakeAt(displayTaskId, lastTick + PAGE_TICK_MS * 1000UL);
+    }
+}
 
-            // Print sensor values to serial monitor
-            Serial.print(">Pressure:");
-            Serial.print(pressure, 5);
-            Serial.println("§mBar"); // Corrected unit symbol
-            Serial.print(">Temp:");
-            Serial.print(temperature, 1);
-            Serial.println("§C"); // Corrected unit symbol
-            Serial.print(">Hum:");
-            Serial.print(humidity, 1);
-            Serial.println("§%"); // Corrected unit symbol
+// --- Telemetry Task: print the latest sample to the serial monitor ---
+void telemetryTask(uint32_t now)
+{
+    (void)now;
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        if (telemetryPending & (1 << i))
+        {
+            const Sensor &sensor = sensorAt(i);
+            uint32_t t = profilerStart();
+            telemetryWriteSample(telemetryWriter, sensor.reading, sensor.stamp, i);
+            telemetryWriteDerived(telemetryWriter, derivedFor(FILTER_OUT_TELEMETRY, i, sensor.reading), sensor.stamp, i);
+            profilerStop(PROF_TELEMETRY, t);
         }
+    }
+    telemetryPending = 0;
+    telemetryWriter.poll(); // One USB write for the whole batch
+}
+
+// --- Console Task: serial commands ---
+void consoleTask(uint32_t now)
+{
+    (void)now;
+    if (Serial.available() > 0)
+    {
+        // Replies are written directly, after what is queued
+        telemetryWriter.hold(true);
+        telemetryWriter.drain(CONSOLE_DRAIN_MS);
+        consolePoll(Serial);
+        telemetryWriter.hold(false);
+    }
+}
 
-        // Blink the built-in LED as a heartbeat ONLY when screen is on
+// --- Heartbeat Task: short LED blink while sampling, ONLY when screen is on ---
+void heartbeatTask(uint32_t now)
+{
+    static bool ledOn = false;
+    static uint32_t lastBlink = 0;
+    if (!ledOn && screen_on && (now - lastBlink) >= HEARTBEAT_PERIOD_MS * 1000UL)
+    {
+        lastBlink = now;
         digitalWrite(PC13, LOW);
-        delay(50);
+        ledOn = true;
+        schedulerWakeAt(heartbeatTaskId, now + HEARTBEAT_ON_MS * 1000UL);
+    }
+    else if (ledOn)
+    {
         digitalWrite(PC13, HIGH);
+        ledOn = false;
+    }
+}
+
+// --- Bus Task: recovers faulted buses, reconnects dropped sensors, reports bus health ---
+void busTask(uint32_t now)
+{
+    (void)now;
+    static I2cHealth reported[I2C_MAX_BUSES];
+    static uint32_t lastReport = 0;
+    uint32_t ms = millis();
+    for (uint8_t b = 0; b < i2cBusCount(); b++)
+    {
+        I2cBus &bus = i2cBusAt(b);
+        if (!i2cBusService(bus, ms, telemetryWriter))
+        {
+            continue;
+        }
+        samplerReconnectBus(&bus); // The sensors may have reset with the bus
+        pagesMark(PAGE_IN_SENSORS);
+        if (&bus == &mainBus && displayReady)
+        {
+            oledRendererInvalidatePanel(); // Pages sent while faulted were dropped
+            schedulerSignal(displayTaskId);
+        }
+    }
+    uint8_t back = samplerReconnect(ms);
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        if (back & (1 << i))
+        {
+            char tag[SENSOR_LABEL_LEN];
+            sensorLabel(i, tag, sizeof(tag));
+            telemetryWriter.print(F("BME280 "));
+            telemetryWriter.print(tag);
+            telemetryWriter.println(F(" reconnected"));
+        }
+    }
+    if (back)
+    {
+        enableSampling(true); // The sampler restarted with the sensor back in
+        pagesMark(PAGE_IN_SENSORS);
+        schedulerSignal(displayTaskId);
+    }
+    if ((ms - lastReport) >= HEALTH_REPORT_MS)
+    {
+        lastReport = ms;
+        for (uint8_t b = 0; b < i2cBusCount(); b++)
+        {
+            const I2cBus &bus = i2cBusAt(b);
+            if (memcmp(&bus.health, &reported[b], sizeof(I2cHealth)) != 0)
+            {
+                reported[b] = bus.health;
+                telemetryWriteHealth(telemetryWriter, b + 1, bus.health, i2cBusClock(bus), ms);
+            }
+        }
+    }
+    // Next wake-up: the earliest recovery, reconnect or report
+    uint32_t next = lastReport + HEALTH_REPORT_MS;
+    uint32_t at;
+    for (uint8_t b = 0; b < i2cBusCount(); b++)
+    {
+        if (i2cBusRetryMs(i2cBusAt(b), at) && (int32_t)(at - next) < 0)
+        {
+            next = at;
+        }
+    }
+    if (samplerNextReconnectMs(at) && (int32_t)(at - next) < 0)
+    {
+        next = at;
+    }
+    int32_t waitMs = (int32_t)(next - millis());
+    schedulerWakeIn(busTaskId, waitMs > 0 ? (uint32_t)waitMs * 1000UL : 0);
+}
+
+// --- Log Task: erases the older flash log sector ahead of the rotation ---
+void logTask(uint32_t now)
+{
+    (void)now;
+    loggerService();
+}
+
+// --- Settings Task: writes changed settings once they have been left alone ---
+// Every change re-arms the deadline, so a burst of them costs one record
+void settingsChanged()
+{
+    schedulerWakeIn(settingsTaskId, SETTINGS_SAVE_DELAY_MS * 1000UL);
+}
+
+// A failed write stays dirty and is retried, backing off to SETTINGS_RETRY_MAX_MS
+void settingsTask(uint32_t now)
+{
+    (void)now;
+    static uint32_t retryMs = SETTINGS_SAVE_DELAY_MS;
+    if (settingsCommit())
+    {
+        retryMs = SETTINGS_SAVE_DELAY_MS;
+        return;
+    }
+    telemetryWriter.println(F("Failed to store the settings!"));
+    if (settingsDirty())
+    {
+        retryMs = min(retryMs * 2, (uint32_t)SETTINGS_RETRY_MAX_MS);
+        schedulerWakeIn(settingsTaskId, retryMs * 1000UL);
+    }
+}
 
-        // Main loop delay when screen is ON (adjust sensor update rate here)
-        delay(950); // Total loop time approx 1000ms (950 + 50 for LED)
+// Tells the serial monitor where a missing device is expected
+void printWiringHint(const char *device, uint8_t addr)
+{
+    telemetryWriter.print(device);
+    telemetryWriter.print(F(" not found. Expecting SCL=PB"));
+    telemetryWriter.print(PIN_WIRE_SCL); // Use defined pin number from variant
+    telemetryWriter.print(F(", SDA=PB"));
+    telemetryWriter.print(PIN_WIRE_SDA);
+    telemetryWriter.print(F(" (Address 0x"));
+    telemetryWriter.print(addr, HEX);
+    telemetryWriter.println(F("). Check wiring."));
+}
+
+bool startDisplay()
+{
+    if (!oledRendererBegin(&Wire, OLED_ADDR))
+    {
+        return false;
     }
-    else // screen_on is false
+    telemetryWriter.println("Display Initialized OK.");
+    return true;
+}
+
+// Registers every BME280 that answers and brings the new ones up
+bool startSensors()
+{
+    sensorsDiscover(&mainBus, 1);
+#ifdef SENSOR_BUS2
+    sensorsDiscover(&sensorBus, 2);
+#endif
+    uint8_t before = sensorsReady();
+    uint8_t ready = samplerStartSensors();
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        char tag[SENSOR_LABEL_LEN];
+        sensorLabel(i, tag, sizeof(tag));
+        telemetryWriter.print(F("BME280 "));
+        telemetryWriter.print(i);
+        telemetryWriter.print(F(" at "));
+        telemetryWriter.print(tag);
+        telemetryWriter.println(sensorAt(i).ready ? F(" OK") : F(" not responding"));
+    }
+    if (ready > before)
     {
+        telemetryWriter.print(F("Sampling profile: "));
+        telemetryWriter.println(samplingProfiles[samplerProfile()].name);
+    }
+    return ready > 0;
+}
 
-        // Ensure LED is OFF when screen is off
-        digitalWrite(PC13, HIGH); // HIGH turns PC13 LED OFF on many boards
+// --- Probe Task: retries devices that were missing at boot, blinking the LED ---
+void probeTask(uint32_t now)
+{
+    (void)now;
+    static bool ledOn = false;
+    if (!displayReady)
+    {
+        displayReady = startDisplay();
+        if (!displayReady)
+        {
+            printWiringHint("SH1106", OLED_ADDR);
+        }
+    }
+    if (!sensorReady)
+    {
+        sensorReady = startSensors();
+        if (sensorReady)
+        {
+            enableSampling(true);
+        }
+        else
+        {
+            printWiringHint("BME280", BME_ADDR);
+        }
+    }
+    pagesMark(PAGE_IN_SENSORS);
+    schedulerSignal(displayTaskId);
+    if (displayReady && sensorReady)
+    {
+        digitalWrite(PC13, HIGH);
+        schedulerEnable(probeTaskId, false);
+        return;
+    }
+    ledOn = !ledOn;
+    digitalWrite(PC13, ledOn ? LOW : HIGH);
+}
+
+#ifdef USE_FREERTOS
+// Highest priority: the sampler state machine, nothing else. Fresh
+// readings leave as copies through sampleQueue, so the slower tasks never
+// hold the sensor registry while they print or program flash.
+void acquisitionThread(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        if (!samplingEnabled)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // enableSampling(true)
+            continue;
+        }
+        busLock();
+        uint8_t failed;
+        uint8_t fresh = acquireSamples(micros(), failed);
+        for (uint8_t i = 0; i < sensorCount(); i++)
+        {
+            if (fresh & (1 << i))
+            {
+                SampleRecord rec = {sensorAt(i).reading, sensorAt(i).readingMs, sensorAt(i).stamp, i};
+                sampleQueue.push(rec); // A full queue drops the sample, not the cadence
+            }
+        }
+        uint32_t next = samplerNextPollUs();
+        busUnlock();
+        if (fresh)
+        {
+            xTaskNotifyGive(telemetryHandle);
+        }
+        if (fresh | failed)
+        {
+            xTaskNotifyGive(uiHandle); // Display and heartbeat were signalled
+        }
+        int32_t waitUs = (int32_t)(next - micros());
+        TickType_t ticks = waitUs > 0 ? pdMS_TO_TICKS(((uint32_t)waitUs + 999) / 1000) : 0;
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+}
+
+// Middle priority: history, flash log and serial output
+void telemetryThread(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        // The timeout keeps draining the writer while the host catches up
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONSOLE_POLL_MS));
+        SampleRecord rec;
+        while (sampleQueue.pop(rec))
+        {
+            // The console changes the filter and derived configuration under
+            // the same lock, which resets their per-output state
+            dataLock();
+            recordSample(rec.sensor, rec.reading, rec.ms, rec.stamp);
+            bool report = filterReport(FILTER_OUT_TELEMETRY, rec.sensor, rec.reading, rec.ms);
+            DerivedValues derived;
+            if (report)
+            {
+                derived = derivedFor(FILTER_OUT_TELEMETRY, rec.sensor, rec.reading);
+            }
+            dataUnlock();
+            if (!report)
+            {
+                continue;
+            }
+            uint32_t t = profilerStart();
+            telemetryWriteSample(telemetryWriter, rec.reading, rec.stamp, rec.sensor);
+            telemetryWriteDerived(telemetryWriter, derived, rec.stamp, rec.sensor);
+            profilerStop(PROF_TELEMETRY, t);
+        }
+        telemetryWriter.poll();
+    }
+}
+
+// Lowest priority: the cooperative tasks that remain (button, screen,
+// console, heartbeat, ...). Each pass holds both locks, so the console
+// sees a consistent registry and log, at the cost of delaying a sample
+// by at most the length of one pass.
+void uiThread(void *arg)
+{
+    (void)arg;
+    heapGuardLock(); // The scheduler has allocated its idle and timer tasks by now
+    for (;;)
+    {
+        busLock();
+        dataLock();
+        bool ran = schedulerRun();
+        dataUnlock();
+        busUnlock();
+        if (ran)
+        {
+            continue;
+        }
+        uint32_t us = schedulerTimeToNextUs();
+        if (us == 0)
+        {
+            continue; // Signalled since the pass
+        }
+        TickType_t ticks = us == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(us / 1000 + 1);
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+}
+
+void startThreads()
+{
+    busMutex = xSemaphoreCreateMutex();
+    dataMutex = xSemaphoreCreateMutex();
+    xTaskCreate(acquisitionThread, "acq", ACQ_STACK_WORDS, nullptr, ACQ_PRIORITY, &acquisitionHandle);
+    xTaskCreate(telemetryThread, "telemetry", TELEMETRY_STACK_WORDS, nullptr, TELEMETRY_PRIORITY, &telemetryHandle);
+    xTaskCreate(uiThread, "ui", UI_STACK_WORDS, nullptr, UI_PRIORITY, &uiHandle);
+    vTaskStartScheduler(); // Does not return
+}
+#endif
+
+void setup()
+{
+    pinMode(PC13, OUTPUT);
+    buttonBegin(BUTTON_PIN, handleButtonEvent);
+
+    digitalWrite(PC13, HIGH); // Turn off built-in LED initially
+
+    Serial.begin(SERIAL_BAUD);
+    telemetryWriter.begin(Serial); // Everything below is queued and sent in batches
+    profilerBegin();
+    Wire.begin(); // Use default SDA/SCL pins defined by the board variant (PB7/PB6 for Blackpill)
+
+    telemetryWriter.println("Starting Initialization...");
+    telemetryWriter.println("--------------------------");
+
+    // --- Load persisted settings ---
+    if (!settingsLoad())
+    {
+        telemetryWriter.println(F("No stored settings, using defaults."));
+    }
+    telemetrySetFormat((TelemetryFormat)settings.telemetryFormat);
+    samplerSetPeriodMs(settings.periodMs);
+    filterSetConfig(settings.filter);
+    derivedSetConfig(settings.derived);
+    buttonSetDebounceMs(settings.debounceMs);
+    rtcTimeBegin(); // Wall clock for the sample stamps and the flash log
+    rtcTimeSetCalibration(settings.rtcPpm);
+    loggerBegin(); // Finds the write position in the flash log
+
+    // --- Register Tasks ---
+    // Registration order is priority order when several tasks are due together
+    buttonTaskId = schedulerAddEvent("button", buttonTask);
+    uiTaskId = schedulerAddEvent("ui", uiTask);
+#ifndef USE_FREERTOS
+    sampleTaskId = schedulerAddEvent("sample", sampleTask); // Threads of their own with the RTOS
+#endif
+    displayTaskId = schedulerAddEvent("display", displayTask);
+#ifndef USE_FREERTOS
+    telemetryTaskId = schedulerAddEvent("telemetry", telemetryTask);
+#endif
+    heartbeatTaskId = schedulerAddEvent("heartbeat", heartbeatTask);
+    oledTaskId = schedulerAddEvent("oled", oledTask);
+    consoleTaskId = schedulerAddPeriodic("console", consoleTask, CONSOLE_POLL_MS * 1000UL);
+    backgroundTaskId = schedulerAddEvent("background", backgroundTask);
+    probeTaskId = schedulerAddPeriodic("probe", probeTask, PROBE_RETRY_MS * 1000UL);
+    busTaskId = schedulerAddEvent("bus", busTask);
+    logTaskId = schedulerAddEvent("log", logTask);                // Last two: run when nothing else is due
+    settingsTaskId = schedulerAddEvent("settings", settingsTask);
+    settingsOnDirty(settingsChanged);
+    addPages();
+    schedulerEnable(backgroundTaskId, false); // Only runs with the screen off
+    schedulerEnable(probeTaskId, false);      // Only runs while a device is missing
 
-        // Add a small delay when screen is off to prevent busy-waiting
-        // and reduce CPU usage, while still being responsive to button.
-        delay(100);
+    // --- Probe every device once, then set the I2C clock ---
+    i2cBusBegin(mainBus, &Wire);
+    i2cBusSetPins(mainBus, I2C_SDA, I2C_SCL);
+    i2cBusNegotiate(mainBus, busDevices, sizeof(busDevices) / sizeof(busDevices[0]), telemetryWriter);
+#ifdef SENSOR_BUS2
+    Wire2.begin();
+    i2cBusBegin(sensorBus, &Wire2);
+    i2cBusSetPins(sensorBus, I2C2_SDA, I2C2_SCL);
+    i2cBusNegotiate(sensorBus, sensorBusDevices, sizeof(sensorBusDevices) / sizeof(sensorBusDevices[0]), telemetryWriter);
+#endif
+
+    // --- Sensors first: their first conversions run while the display initialises ---
+    samplerSetProfile((SamplingProfileId)settings.profile); // Applied to each sensor as it comes up
+    sensorReady = startSensors();
+    enableSampling(sensorReady);
+#ifndef USE_FREERTOS
+    if (sensorReady)
+    {
+        sampleTask(micros()); // Triggers the first conversion right away
+    }
+#endif
+
+    displayReady = startDisplay();
+    if (!displayReady || !sensorReady)
+    {
+        schedulerEnable(probeTaskId, true); // Reports and retries the missing part
     }
+    schedulerSignal(busTaskId); // Starts the health reports and any recovery the boot left due
 
-end_of_loop:; // Label for the goto statement
+    // --- Attach Interrupt ---
+    powerBegin(BUTTON_PIN, buttonEdgeInterrupt, CHANGE); // EXTI also wakes from STOP
+
+    if (BOOT_SPLASH_MS && displayReady)
+    {
+        showSplash(screenReady);
+        uiState = UI_MESSAGE;
+        schedulerWakeIn(uiTaskId, BOOT_SPLASH_MS * 1000UL);
+    }
+
+    telemetryWriter.println("Setup Complete. Entering main loop.");
+    telemetryWriter.println("==========================");
+#ifdef USE_FREERTOS
+    startThreads();
+#else
+    heapGuardLock(); // Everything from here on runs on static buffers
+#endif
+}
 
-} // End of loop()
+void loop()
+{
+    if (!schedulerRun())
+    {
+        telemetryWriter.poll(); // Drains a backlog once the host reads again
+        if (uiState == UI_OFF && !buttonBusy())
+        {
+            powerIdle(schedulerTimeToNextUs()); // STOP until the button or the next deadline
+        }
+        else
+        {
+            schedulerIdle();
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#include "oled_glyphs.h"
+
+void glyphDrawChar(uint8_t *fb, uint16_t width, uint8_t page, int16_t x, char c)
+{
+    static const uint8_t blank[GLYPH_WIDTH] = {0};
+    const uint8_t *g = (c >= GLYPH_FIRST && c <= GLYPH_LAST) ? glyphFont[c - GLYPH_FIRST] : blank;
+    uint8_t *row = fb + (uint16_t)page * width;
+    if (x >= 0 && x + GLYPH_ADVANCE <= (int16_t)width)
+    {
+        // Fast path: the whole cell is visible
+        memcpy(row + x, g, GLYPH_WIDTH);
+        row[x + GLYPH_WIDTH] = 0;
+        return;
+    }
+    for (int16_t i = 0; i < GLYPH_ADVANCE; i++)
+    {
+        int16_t col = x + i;
+        if (col >= 0 && col < (int16_t)width)
+        {
+            row[col] = i < GLYPH_WIDTH ? g[i] : 0;
+        }
+    }
+}
+
+int16_t glyphDrawText(uint8_t *fb, uint16_t width, uint8_t page, int16_t x, const char *text)
+{
+    for (; *text; text++)
+    {
+        glyphDrawChar(fb, width, page, x, *text);
+        x += GLYPH_ADVANCE;
+    }
+    return x;
+}
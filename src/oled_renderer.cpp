@@ -0,0 +1,352 @@
+#include "oled_renderer.h"
+#include "oled_transport.h"
+#include "fixed_format.h"
+#include "oled_glyphs.h"
+#include "oled_image.h"
+
+struct ValueField
+{
+    int16_t x;
+    uint8_t page;   // text row, one 8-pixel page
+    uint8_t chars;  // fixed width, values are right-aligned
+    uint8_t digits; // decimals
+    char last[12];  // text currently in the framebuffer
+};
+
+// Layout of the sensor screen. Values are right-aligned in a fixed-width
+// field so that the labels and units never move. Rows sit on page
+// boundaries so every character is a straight column copy.
+static constexpr int16_t LABEL_X = 10;
+static constexpr int16_t PRESS_X = LABEL_X + glyphTextWidth("Press: ");
+static constexpr int16_t TEMP_X = LABEL_X + glyphTextWidth("Temp: ");
+static constexpr int16_t HUM_X = LABEL_X + glyphTextWidth("Hum: ");
+static constexpr uint8_t PRESS_CHARS = 7; // 1013.25
+static constexpr uint8_t TEMP_CHARS = 5;  // -10.5
+static constexpr uint8_t HUM_CHARS = 5;   // 45.2
+
+static ValueField fields[3] = {
+    {PRESS_X, 1, PRESS_CHARS, 2, ""},
+    {TEMP_X, 3, TEMP_CHARS, 1, ""},
+    {HUM_X, 5, HUM_CHARS, 1, ""},
+};
+
+// Which sensor is shown, bottom right; blank with a single sensor
+static constexpr uint8_t TAG_CHARS = 4; // "1:76"
+static ValueField tagField = {OLED_WIDTH - 4 - TAG_CHARS * GLYPH_ADVANCE, 6, TAG_CHARS, 0, ""};
+
+// Border, labels and units, rendered by the compiler
+static constexpr OledImage sensorLayout = oledScreen(
+    true,
+    oledLineAt(1, LABEL_X, "Press:"), oledLineAt(1, PRESS_X + PRESS_CHARS * GLYPH_ADVANCE, " mBar"),
+    oledLineAt(3, LABEL_X, "Temp:"), oledLineAt(3, TEMP_X + TEMP_CHARS * GLYPH_ADVANCE, " C"),
+    oledLineAt(5, LABEL_X, "Hum:"), oledLineAt(5, HUM_X + HUM_CHARS * GLYPH_ADVANCE, " %"));
+
+// Two frames: one is drawn while the other goes out to the panel. A flush
+// flips them between passes, so a pass never sends a half-drawn frame and
+// drawing never waits for the bus. Right after a flip both hold the same
+// image, and until the pass ends the front one is also what the panel
+// shows; the changed spans are found by comparing the two.
+static uint8_t buffers[2][OLED_PAGES * OLED_WIDTH];
+static uint8_t *framebuffer = buffers[0]; // being drawn
+static uint8_t *front = buffers[1];       // being sent, or last sent
+
+struct PageSpan
+{
+    uint8_t first;
+    uint8_t len; // 0 = page unchanged
+};
+static PageSpan spans[OLED_PAGES]; // what the running pass sends from front
+static uint8_t dirtyPages = 0;     // pages drawn since the last flip, one bit each
+
+// What the framebuffer holds besides freely drawn text
+enum Layout
+{
+    LAYOUT_NONE,
+    LAYOUT_SENSOR, // static parts of the sensor screen, fields track their text
+    LAYOUT_GRAPH,  // cleared plot area, columns drawn by the caller
+};
+
+static bool panelValid = false;
+static Layout layout = LAYOUT_NONE;
+static uint32_t bytesSent = 0;
+static int8_t flushPage = -1; // next page of the running flush pass, -1 when idle
+static bool flipPending = false;
+static bool panelOn = true;
+
+#define ALL_PAGES 0xFF
+static_assert(OLED_PAGES == 8, "dirtyPages holds one bit per page");
+
+static void flushStep();
+
+bool oledRendererBegin(TwoWire *wire, uint8_t addr)
+{
+    oledTransportBegin(wire, addr);
+    oledTransportOnComplete(flushStep);
+    flushPage = -1;
+    flipPending = false;
+    panelOn = false;
+    if (!oledTransportInitPanel())
+    {
+        return false;
+    }
+    // Blank the panel RAM while it is still dark, then light it
+    memset(framebuffer, 0, sizeof(buffers[0]));
+    dirtyPages = ALL_PAGES;
+    panelValid = false;
+    layout = LAYOUT_NONE;
+    oledRendererFlushWait();
+    return oledRendererSetPower(true);
+}
+
+void oledRendererInvalidatePanel()
+{
+    panelValid = false;
+}
+
+void oledRendererClear()
+{
+    memset(framebuffer, 0, sizeof(buffers[0]));
+    dirtyPages = ALL_PAGES;
+    layout = LAYOUT_NONE;
+}
+
+static void drawStaticLayout()
+{
+    memcpy(framebuffer, sensorLayout.data, sizeof(sensorLayout.data));
+    dirtyPages = ALL_PAGES;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        fields[i].last[0] = '\0';
+    }
+    tagField.last[0] = '\0';
+    layout = LAYOUT_SENSOR;
+}
+
+static void updateText(ValueField &f, const char *text)
+{
+    if (strcmp(text, f.last) == 0)
+    {
+        return;
+    }
+    // Only cells whose character changed are overwritten
+    size_t len = strlen(text);
+    size_t lastLen = strlen(f.last);
+    for (size_t i = 0; i < len; i++)
+    {
+        if (i < lastLen && len == lastLen && text[i] == f.last[i])
+        {
+            continue;
+        }
+        glyphDrawChar(framebuffer, OLED_WIDTH, f.page, f.x + (int16_t)i * GLYPH_ADVANCE, text[i]);
+        dirtyPages |= 1 << f.page;
+    }
+    strncpy(f.last, text, sizeof(f.last) - 1);
+    f.last[sizeof(f.last) - 1] = '\0';
+}
+
+// value is fixed-point in units of 10^-f.digits
+static void updateField(ValueField &f, int32_t value)
+{
+    char text[sizeof(f.last)];
+    formatFixed(text, sizeof(text), value, f.digits, f.chars);
+    updateText(f, text);
+}
+
+void oledRendererSensorScreen(const SensorReading &reading, const char *tag)
+{
+    if (layout != LAYOUT_SENSOR)
+    {
+        drawStaticLayout();
+    }
+    char text[sizeof(tagField.last)];
+    snprintf(text, sizeof(text), "%*s", TAG_CHARS, tag ? tag : "");
+    updateText(tagField, text);
+    updateField(fields[0], (int32_t)pressurePa(reading.pressure)); // Pa == centi-mBar
+    updateField(fields[1], divRound(reading.temperature, 10));
+    updateField(fields[2], (int32_t)((reading.humidity * 10 + 512) >> 10));
+}
+
+void oledRendererShowImage(const OledImage &image)
+{
+    memcpy(framebuffer, image.data, sizeof(image.data));
+    dirtyPages = ALL_PAGES;
+    layout = LAYOUT_NONE;
+}
+
+void oledRendererText(uint8_t page, int16_t x, const char *text)
+{
+    glyphDrawText(framebuffer, OLED_WIDTH, page, x, text);
+    dirtyPages |= 1 << page;
+}
+
+void oledRendererCenteredText(uint8_t page, const char *text)
+{
+    oledRendererText(page, (OLED_WIDTH - glyphTextWidth(text)) / 2, text);
+}
+
+void oledRendererGraphBegin()
+{
+    memset(framebuffer, 0, sizeof(buffers[0]));
+    dirtyPages = ALL_PAGES;
+    layout = LAYOUT_GRAPH;
+}
+
+bool oledRendererGraphShown()
+{
+    return layout == LAYOUT_GRAPH;
+}
+
+// Plot row r (0 = bottom) is screen row OLED_HEIGHT - 1 - r. The column
+// is rebuilt page by page as a byte mask, so drawing it is one store per
+// plot page and the flush sends one byte per page.
+void oledRendererGraphColumn(uint8_t x, int8_t y0, int8_t y1)
+{
+    if (x >= OLED_WIDTH)
+    {
+        return;
+    }
+    if (y0 > y1)
+    {
+        int8_t t = y0;
+        y0 = y1;
+        y1 = t;
+    }
+    int16_t top = OLED_HEIGHT - 1 - y1; // screen rows, top < bottom
+    int16_t bottom = OLED_HEIGHT - 1 - y0;
+    for (uint8_t page = OLED_GRAPH_PAGE; page < OLED_PAGES; page++)
+    {
+        int16_t row0 = page * 8;
+        uint8_t bits = 0;
+        if (y1 >= 0 && bottom >= row0 && top < row0 + 8)
+        {
+            int16_t from = max<int16_t>(top, row0) - row0;
+            int16_t to = min<int16_t>(bottom, row0 + 7) - row0;
+            bits = (uint8_t)((0xFF << from) & (0xFF >> (7 - to)));
+        }
+        framebuffer[page * OLED_WIDTH + x] = bits;
+    }
+    dirtyPages |= (uint8_t)(ALL_PAGES << OLED_GRAPH_PAGE);
+}
+
+// Makes the drawn frame the front one and works out which span of each
+// page differs from what the panel shows. Only pages drawn since the last
+// flip are compared. The new draw buffer is brought up to date with the
+// same spans, so drawing carries on from the frame just sent.
+static void flip()
+{
+    uint8_t pages = panelValid ? dirtyPages : ALL_PAGES;
+    uint8_t *next = front;
+    front = framebuffer;
+    framebuffer = next;
+    dirtyPages = 0;
+    for (uint8_t page = 0; page < OLED_PAGES; page++)
+    {
+        spans[page].len = 0;
+        if (!(pages & (1 << page)))
+        {
+            continue;
+        }
+        const uint8_t *row = front + page * OLED_WIDTH;
+        uint8_t *old = next + page * OLED_WIDTH;
+        int16_t first = 0;
+        int16_t last = OLED_WIDTH - 1;
+        if (panelValid)
+        {
+            while (first < OLED_WIDTH && row[first] == old[first])
+            {
+                first++;
+            }
+            if (first == OLED_WIDTH)
+            {
+                continue; // drawn over with the same pixels
+            }
+            while (row[last] == old[last])
+            {
+                last--;
+            }
+        }
+        uint8_t len = (uint8_t)(last - first + 1);
+        spans[page] = {(uint8_t)first, len};
+        memcpy(old + first, row + first, len);
+    }
+}
+
+// Sends changed pages until the transport reports busy. With DMA this
+// starts one page and returns; the completion callback resumes the pass.
+static void flushStep()
+{
+    while (flushPage >= 0 && !oledTransportBusy())
+    {
+        if (flushPage >= OLED_PAGES)
+        {
+            panelValid = true;
+            if (flipPending)
+            {
+                // A frame was finished while this one went out
+                flipPending = false;
+                flip();
+                flushPage = 0;
+                continue;
+            }
+            flushPage = -1;
+            break;
+        }
+        uint8_t page = (uint8_t)flushPage++;
+        const PageSpan &span = spans[page];
+        if (span.len == 0)
+        {
+            continue;
+        }
+        oledTransportSendPage(page, span.first, front + page * OLED_WIDTH + span.first, span.len);
+        bytesSent += span.len;
+    }
+}
+
+void oledRendererFlush()
+{
+    if (flushPage >= 0)
+    {
+        flipPending = true; // the front buffer is busy, flip when the pass ends
+        return;
+    }
+    flip();
+    flushPage = 0;
+    flushStep();
+}
+
+bool oledRendererPoll()
+{
+    oledTransportPoll();
+    return flushPage >= 0;
+}
+
+void oledRendererFlushWait()
+{
+    oledRendererFlush();
+    while (oledRendererPoll())
+    {
+    }
+}
+
+bool oledRendererSetPower(bool on)
+{
+    while (oledRendererPoll())
+    {
+    }
+    if (!oledTransportCommand(on ? SH1106_DISPLAYON : SH1106_DISPLAYOFF))
+    {
+        return false;
+    }
+    panelOn = on;
+    return true;
+}
+
+bool oledRendererPowered()
+{
+    return panelOn;
+}
+
+uint32_t oledRendererBytesSent()
+{
+    return bytesSent;
+}
@@ -0,0 +1,258 @@
+#include "oled_transport.h"
+#include "i2c_bus.h"
+
+#define OLED_WIDTH_MAX 128
+
+// Control bytes: Co=1 means one command byte follows, 0x40 starts a data run
+#define SH1106_CTRL_CMD_SINGLE 0x80
+#define SH1106_CTRL_CMD_STREAM 0x00
+#define SH1106_CTRL_DATA 0x40
+#define SH1106_SETPAGE 0xB0
+#define SH1106_SETCOL_LO 0x00
+#define SH1106_SETCOL_HI 0x10
+#define PACKET_HEADER 7
+
+// Largest single Wire transmission; the STM32 core buffers 32 bytes
+#define OLED_I2C_MAX 32
+
+#if defined(STM32F4xx) && defined(HAL_DMA_MODULE_ENABLED) && !defined(OLED_TRANSPORT_BLOCKING)
+#define OLED_TRANSPORT_DMA 1
+#endif
+
+static TwoWire *bus = nullptr;
+static uint8_t oledAddr = 0x3C;
+static OledTransportCallback onComplete = nullptr;
+static uint8_t packet[PACKET_HEADER + OLED_WIDTH_MAX];
+
+#ifdef OLED_TRANSPORT_DMA
+// I2C1_TX is request channel 1 on DMA1 stream 6 (RM0383, table 27)
+static DMA_HandleTypeDef hdmaTx;
+static I2C_HandleTypeDef *hi2c = nullptr;
+static bool dmaReady = false;
+static volatile bool inFlight = false;
+static uint32_t startUs = 0;
+
+// A full page at 100 kHz takes about 13 ms; past this the bus is stuck
+#define DMA_TIMEOUT_US 30000
+
+extern "C" void DMA1_Stream6_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdmaTx);
+}
+
+static bool dmaBegin()
+{
+    hi2c = bus->getHandle();
+    if (hi2c == nullptr || hi2c->Instance != I2C1)
+    {
+        return false; // only the I2C1 stream mapping is wired up
+    }
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdmaTx.Instance = DMA1_Stream6;
+    hdmaTx.Init.Channel = DMA_CHANNEL_1;
+    hdmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdmaTx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdmaTx.Init.MemInc = DMA_MINC_ENABLE;
+    hdmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdmaTx.Init.Mode = DMA_NORMAL;
+    hdmaTx.Init.Priority = DMA_PRIORITY_LOW;
+    hdmaTx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdmaTx) != HAL_OK)
+    {
+        return false;
+    }
+    __HAL_LINKDMA(hi2c, hdmatx, hdmaTx);
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+    return true;
+}
+
+// The end of a DMA transfer is finished by the I2C event IRQ (already
+// serviced by the core), which returns the handle to READY.
+static bool dmaDone()
+{
+    return HAL_I2C_GetState(hi2c) == HAL_I2C_STATE_READY;
+}
+
+// Gives up on a transfer that stalled on a stuck bus. The bus fault
+// handling restarts the peripheral before it is used again.
+static void dmaCheckTimeout()
+{
+    if (inFlight && !dmaDone() && (micros() - startUs) > DMA_TIMEOUT_US)
+    {
+        HAL_DMA_Abort(&hdmaTx);
+        inFlight = false;
+        i2cRecordStatus(bus, I2C_STATUS_TIMEOUT);
+    }
+}
+#endif
+
+bool oledTransportBegin(TwoWire *wire, uint8_t addr)
+{
+    bus = wire;
+    oledAddr = addr;
+#ifdef OLED_TRANSPORT_DMA
+    if (!dmaReady)
+    {
+        dmaReady = dmaBegin();
+    }
+    return dmaReady;
+#else
+    return false;
+#endif
+}
+
+// Sends a prepared packet with plain Wire writes, re-prefixing each chunk
+// after the first with a data control byte.
+static void sendBlocking(uint16_t len)
+{
+    uint16_t n = len < OLED_I2C_MAX ? len : OLED_I2C_MAX;
+    bus->beginTransmission(oledAddr);
+    bus->write(packet, n);
+    i2cRecordStatus(bus, bus->endTransmission());
+    while (n < len)
+    {
+        uint16_t chunk = len - n;
+        if (chunk > OLED_I2C_MAX - 1)
+        {
+            chunk = OLED_I2C_MAX - 1;
+        }
+        bus->beginTransmission(oledAddr);
+        bus->write(SH1106_CTRL_DATA);
+        bus->write(packet + n, chunk);
+        i2cRecordStatus(bus, bus->endTransmission());
+        n += chunk;
+    }
+}
+
+bool oledTransportSendPage(uint8_t page, uint8_t col, const uint8_t *data, uint8_t len)
+{
+    if (oledTransportBusy())
+    {
+        return false;
+    }
+    if (!i2cWireReady(bus))
+    {
+        return true; // dropped; the panel is repainted once the bus recovers
+    }
+    uint8_t ramCol = col + OLED_COLUMN_OFFSET;
+    packet[0] = SH1106_CTRL_CMD_SINGLE;
+    packet[1] = SH1106_SETPAGE | page;
+    packet[2] = SH1106_CTRL_CMD_SINGLE;
+    packet[3] = SH1106_SETCOL_HI | (ramCol >> 4);
+    packet[4] = SH1106_CTRL_CMD_SINGLE;
+    packet[5] = SH1106_SETCOL_LO | (ramCol & 0x0F);
+    packet[6] = SH1106_CTRL_DATA;
+    memcpy(packet + PACKET_HEADER, data, len);
+    uint16_t total = PACKET_HEADER + len;
+
+#ifdef OLED_TRANSPORT_DMA
+    if (dmaReady)
+    {
+        inFlight = true;
+        startUs = micros();
+        if (HAL_I2C_Master_Transmit_DMA(hi2c, (uint16_t)(oledAddr << 1), packet, total) == HAL_OK)
+        {
+            return true;
+        }
+        inFlight = false; // HAL refused (bus busy/error): send this one the slow way
+    }
+#endif
+    sendBlocking(total);
+    return true;
+}
+
+bool oledTransportBusy()
+{
+#ifdef OLED_TRANSPORT_DMA
+    dmaCheckTimeout();
+    return inFlight && !dmaDone();
+#else
+    return false;
+#endif
+}
+
+void oledTransportWaitIdle()
+{
+    while (oledTransportBusy())
+    {
+    }
+}
+
+void oledTransportPoll()
+{
+#ifdef OLED_TRANSPORT_DMA
+    if (inFlight && dmaDone())
+    {
+        inFlight = false;
+        if (onComplete)
+        {
+            onComplete();
+        }
+    }
+#endif
+}
+
+void oledTransportOnComplete(OledTransportCallback cb)
+{
+    onComplete = cb;
+}
+
+// Sends a command list as a stream, in chunks that fit the Wire buffer
+static bool sendCommands(const uint8_t *cmds, uint8_t len)
+{
+    oledTransportWaitIdle();
+    if (!i2cWireReady(bus))
+    {
+        return false;
+    }
+    uint8_t sent = 0;
+    while (sent < len)
+    {
+        uint8_t chunk = len - sent;
+        if (chunk > OLED_I2C_MAX - 1)
+        {
+            chunk = OLED_I2C_MAX - 1;
+        }
+        bus->beginTransmission(oledAddr);
+        bus->write(SH1106_CTRL_CMD_STREAM);
+        bus->write(cmds + sent, chunk);
+        if (!i2cRecordStatus(bus, bus->endTransmission()))
+        {
+            return false;
+        }
+        sent += chunk;
+    }
+    return true;
+}
+
+bool oledTransportCommand(uint8_t cmd)
+{
+    return sendCommands(&cmd, 1);
+}
+
+bool oledTransportInitPanel()
+{
+    // Same register setup the Adafruit SH1106G driver uses, minus its
+    // fixed 100 ms settle delay: the caller's first full-frame write covers it.
+    static const uint8_t init[] = {
+        SH1106_DISPLAYOFF,
+        0xD5, 0x80, // clock divide ratio / oscillator
+        0xA8, 0x3F, // multiplex ratio: 64 rows
+        0xD3, 0x00, // display offset
+        0x40,       // start line 0
+        0xAD, 0x8B, // DC-DC converter on
+        0xA1,       // segment remap (column 131 -> SEG0)
+        0xC8,       // COM scan direction: remapped
+        0xDA, 0x12, // COM pins: alternative
+        0x81, 0xFF, // contrast
+        0xD9, 0x1F, // pre-charge period
+        0xDB, 0x40, // VCOM deselect level
+        0x33,       // pump voltage 9 V
+        0xA6,       // normal (not inverted)
+        0xA4,       // output follows RAM
+    };
+    return sendCommands(init, sizeof(init));
+}
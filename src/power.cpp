@@ -0,0 +1,51 @@
+#include "power.h"
+
+#if POWER_USE_STOP
+#include <STM32LowPower.h>
+#include <STM32RTC.h>
+
+static STM32RTC &rtc = STM32RTC::getInstance();
+
+// Milliseconds on the RTC calendar, for measuring time spent in STOP
+static uint64_t rtcMillis()
+{
+    uint32_t subSeconds = 0;
+    uint32_t epoch = rtc.getEpoch(&subSeconds);
+    return (uint64_t)epoch * 1000ULL + subSeconds;
+}
+#endif
+
+void powerBegin(uint32_t wakePin, void (*isr)(void), uint32_t mode)
+{
+#if POWER_USE_STOP
+    // The RTC itself is started by rtcTimeBegin()
+    LowPower.begin();
+    LowPower.attachInterruptWakeup(wakePin, isr, mode, DEEP_SLEEP_MODE);
+#else
+    attachInterrupt(digitalPinToInterrupt(wakePin), isr, mode);
+#endif
+}
+
+void powerIdle(uint32_t maxSleepUs)
+{
+#if POWER_USE_STOP
+    if (maxSleepUs >= POWER_MIN_STOP_US)
+    {
+        uint32_t ms = (maxSleepUs == UINT32_MAX) ? 0 : maxSleepUs / 1000; // 0: no RTC alarm
+        uint64_t before = rtcMillis();
+        LowPower.deepSleep(ms);
+        uint32_t slept = (uint32_t)(rtcMillis() - before);
+
+        // Credit the sleep to the HAL tick so millis()/micros() move on
+        noInterrupts();
+        uwTick += slept;
+        interrupts();
+        return;
+    }
+#else
+    (void)maxSleepUs;
+#endif
+#if defined(ARDUINO_ARCH_STM32)
+    __WFI();
+#endif
+}
@@ -0,0 +1,113 @@
+#include "profiler.h"
+
+#if defined(ARDUINO_ARCH_STM32) && defined(DWT)
+#define PROFILER_DWT 1
+#endif
+
+static ProfileStats stats[PROF_SECTIONS];
+
+static const char *const sectionNames[PROF_SECTIONS] = {
+    "sensor_read", "compensate", "render", "flush", "telemetry", "logger",
+};
+
+// Upper bounds of the histogram buckets, in us; the last bucket is open
+static const uint32_t bucketLimitUs[PROFILE_BUCKETS - 1] = {1, 10, 100, 1000, 10000};
+
+static uint32_t cyclesPerUs()
+{
+#ifdef PROFILER_DWT
+    return SystemCoreClock / 1000000;
+#else
+    return 1;
+#endif
+}
+
+uint32_t profilerCyclesToUs(uint64_t cycles)
+{
+    return (uint32_t)(cycles / cyclesPerUs());
+}
+
+#if PROFILER_ENABLE
+void profilerBegin()
+{
+#ifdef PROFILER_DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    profilerReset();
+}
+
+uint32_t profilerStart()
+{
+#ifdef PROFILER_DWT
+    return DWT->CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+void profilerStop(ProfileSection section, uint32_t start)
+{
+    uint32_t cycles = profilerStart() - start; // wrap-safe, CYCCNT wraps every ~44 s
+    ProfileStats &s = stats[section];
+    s.count++;
+    s.minCycles = min(s.minCycles, cycles);
+    s.maxCycles = max(s.maxCycles, cycles);
+    s.totalCycles += cycles;
+    uint32_t us = cycles / cyclesPerUs();
+    uint8_t b = 0;
+    while (b < PROFILE_BUCKETS - 1 && us >= bucketLimitUs[b])
+    {
+        b++;
+    }
+    s.histogram[b]++;
+}
+#endif
+
+void profilerReset()
+{
+    for (uint8_t i = 0; i < PROF_SECTIONS; i++)
+    {
+        stats[i] = {};
+        stats[i].minCycles = UINT32_MAX;
+    }
+}
+
+const ProfileStats &profilerStats(ProfileSection section)
+{
+    return stats[section];
+}
+
+const char *profilerName(ProfileSection section)
+{
+    return sectionNames[section];
+}
+
+void profilerReport(Print &out)
+{
+    out.println(F("section,count,min_us,mean_us,max_us,<1us,<10us,<100us,<1ms,<10ms,more"));
+    for (uint8_t i = 0; i < PROF_SECTIONS; i++)
+    {
+        const ProfileStats &s = stats[i];
+        if (s.count == 0)
+        {
+            continue;
+        }
+        out.print(sectionNames[i]);
+        out.print(',');
+        out.print(s.count);
+        out.print(',');
+        out.print(profilerCyclesToUs(s.minCycles));
+        out.print(',');
+        out.print(profilerCyclesToUs(s.totalCycles / s.count));
+        out.print(',');
+        out.print(profilerCyclesToUs(s.maxCycles));
+        for (uint8_t b = 0; b < PROFILE_BUCKETS; b++)
+        {
+            out.print(',');
+            out.print(s.histogram[b]);
+        }
+        out.println();
+    }
+}
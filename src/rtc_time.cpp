@@ -0,0 +1,112 @@
+#include "rtc_time.h"
+
+#if defined(ARDUINO_ARCH_STM32)
+#include <STM32RTC.h>
+#define RTC_HARDWARE 1
+static STM32RTC &rtc = STM32RTC::getInstance();
+#endif
+
+static uint32_t baseSeconds = 0; // wall time at baseUs
+static uint32_t baseUs = 0;      // micros() at a whole second of wall time
+static uint32_t syncedUs = 0;    // micros() of the last RTC read
+static RtcTime last = {0, 0};
+
+// Lines the micros() epoch up with the RTC calendar
+static void sync()
+{
+#ifdef RTC_HARDWARE
+    uint32_t subMs = 0;
+    uint32_t epoch = rtc.getEpoch(&subMs);
+    uint32_t now = micros();
+    baseSeconds = epoch;
+    baseUs = now - subMs * 1000;
+    syncedUs = now;
+#else
+    syncedUs = micros();
+#endif
+}
+
+void rtcTimeBegin()
+{
+#ifdef RTC_HARDWARE
+    rtc.setClockSource(STM32RTC::LSE_CLOCK);
+    rtc.begin(); // no reset: the backup domain keeps the calendar
+#endif
+    sync();
+}
+
+void rtcTimeNow(RtcTime &t)
+{
+    if ((micros() - syncedUs) >= RTC_TIME_RESYNC_US)
+    {
+        sync();
+    }
+    // Whole seconds move into the base, so the difference stays far from the micros() wrap
+    uint32_t elapsed = micros() - baseUs;
+    baseSeconds += elapsed / 1000000UL;
+    baseUs += (elapsed / 1000000UL) * 1000000UL;
+    t.seconds = baseSeconds;
+    t.micros = elapsed % 1000000UL;
+    if (t.seconds < last.seconds || (t.seconds == last.seconds && t.micros <= last.micros))
+    {
+        // A resync stepped back; hold the line 1 us past the last stamp
+        t = last;
+        if (++t.micros == 1000000UL)
+        {
+            t.micros = 0;
+            t.seconds++;
+        }
+    }
+    last = t;
+}
+
+uint32_t rtcTimeSeconds()
+{
+    RtcTime t;
+    rtcTimeNow(t);
+    return t.seconds;
+}
+
+void rtcTimeSet(uint32_t seconds)
+{
+#ifdef RTC_HARDWARE
+    rtc.setEpoch(seconds);
+    sync();
+#else
+    baseSeconds = seconds;
+    baseUs = micros();
+#endif
+    last.seconds = 0;
+    last.micros = 0;
+}
+
+bool rtcTimeIsSet()
+{
+#ifdef RTC_HARDWARE
+    return rtc.isTimeSet();
+#else
+    return false;
+#endif
+}
+
+bool rtcTimeSetCalibration(int16_t ppm)
+{
+    if (ppm < -RTC_CALIBRATION_MAX_PPM || ppm > RTC_CALIBRATION_MAX_PPM)
+    {
+        return false;
+    }
+#ifdef RTC_HARDWARE
+    // Each masked pulse (CALM) takes 0.9537 ppm off; CALP adds 512 of them back.
+    // At most 487 ppm, so pulses stays within the 9-bit CALM field.
+    uint32_t pulses = ((uint32_t)abs(ppm) * 10000UL + 4768) / 9537;
+    uint32_t plus = RTC_SMOOTHCALIB_PLUSPULSES_RESET;
+    if (ppm < 0 && pulses)
+    {
+        plus = RTC_SMOOTHCALIB_PLUSPULSES_SET;
+        pulses = 512 - pulses;
+    }
+    return HAL_RTCEx_SetSmoothCalib(RTC_GetHandle(), RTC_SMOOTHCALIB_PERIOD_32SEC, plus, pulses) == HAL_OK;
+#else
+    return true;
+#endif
+}
@@ -0,0 +1,418 @@
+#include "sampler.h"
+#include "rtc_time.h"
+#include "profiler.h"
+
+// osrs codes: 1=x1 2=x2 3=x4 4=x8 5=x16; filter codes: 0=off 2=4 4=16;
+// t_sb codes: 0=0.5 ms 2=125 ms
+const SamplingProfile samplingProfiles[PROFILE_COUNT] = {
+    {"weather", {BME280_MODE_FORCED, 1, 1, 1, 0, 0}, 1000},
+    {"hvac", {BME280_MODE_NORMAL, 1, 3, 1, 2, 2}, 10},
+    {"fast", {BME280_MODE_NORMAL, 2, 5, 1, 4, 0}, 2},
+};
+
+#define FORCED_RECHECK_US 1000 // status poll interval once the conversion should be done
+#define NORMAL_MAX_WAIT_US 1000000 // longest normal-mode sleep; t_sb can be 1 s
+#define PAUSED_POLL_US 10000 // poll interval while paused
+
+enum SamplerState
+{
+    SAMPLER_IDLE,      // forced: waiting for the next trigger
+    SAMPLER_CONVERTING // forced: conversions started; normal: free-running
+};
+
+static SamplingProfileId current = PROFILE_WEATHER;
+static uint16_t periodOverrideMs = 0;
+static SamplerState state = SAMPLER_IDLE;
+static uint32_t nextPoll = 0;
+static uint32_t nextTrigger = 0;
+static uint8_t pending = 0;      // forced: sensors still converting
+static bool paused = false;
+// Normal mode, per sensor: when to start reading the data registers, the
+// time by which a conversion has certainly completed, and the last frame
+static uint32_t dueUs[SENSOR_MAX];
+static uint32_t certainUs[SENSOR_MAX];
+static BmeRawFrame lastFrame[SENSOR_MAX];
+static uint32_t sequence = 0;    // readings taken since boot, all sensors
+
+static inline bool timeReached(uint32_t now, uint32_t deadline)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+SamplingProfileId samplerFindProfile(const char *name)
+{
+    for (uint8_t i = 0; i < PROFILE_COUNT; i++)
+    {
+        if (strcmp(name, samplingProfiles[i].name) == 0)
+        {
+            return (SamplingProfileId)i;
+        }
+    }
+    return PROFILE_COUNT;
+}
+
+static void restart()
+{
+    uint32_t now = micros();
+    nextTrigger = now;
+    nextPoll = now;
+    pending = 0;
+    for (uint8_t i = 0; i < sensorCount() && i < SENSOR_MAX; i++)
+    {
+        // The first normal-mode conversion starts with the configuration
+        dueUs[i] = now + sensorAt(i).bme.measurementTimeUs();
+        certainUs[i] = dueUs[i];
+        memset(&lastFrame[i], 0, sizeof(lastFrame[i]));
+    }
+    state = samplingProfiles[current].config.mode == BME280_MODE_FORCED ? SAMPLER_IDLE : SAMPLER_CONVERTING;
+}
+
+bool samplerSetProfile(SamplingProfileId id)
+{
+    if (id >= PROFILE_COUNT)
+    {
+        return false;
+    }
+    bool ok = true;
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        Sensor &s = sensorAt(i);
+        if (s.ready && !s.bme.configure(samplingProfiles[id].config))
+        {
+            ok = false;
+        }
+    }
+    current = id;
+    restart();
+    return ok;
+}
+
+void samplerPause(bool pause)
+{
+    if (paused && !pause)
+    {
+        restart();
+    }
+    paused = pause;
+}
+
+SamplingProfileId samplerProfile()
+{
+    return current;
+}
+
+void samplerSetPeriodMs(uint16_t ms)
+{
+    periodOverrideMs = ms;
+}
+
+uint16_t samplerPeriodMs()
+{
+    return periodOverrideMs ? periodOverrideMs : samplingProfiles[current].periodMs;
+}
+
+uint8_t samplerStartSensors()
+{
+    bool started = false;
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        Sensor &s = sensorAt(i);
+        if (s.ready)
+        {
+            continue;
+        }
+        s.ready = s.bme.begin(s.addr, s.bus->wire) && s.bme.configure(samplingProfiles[current].config);
+        if (s.ready)
+        {
+            s.failStreak = 0;
+            s.backoffMs = 0;
+        }
+        started |= s.ready;
+    }
+    if (started)
+    {
+        restart();
+    }
+    return sensorsReady();
+}
+
+void samplerStamp(SampleStamp &stamp)
+{
+    RtcTime t;
+    rtcTimeNow(t);
+    stamp.sequence = sequence++;
+    stamp.seconds = t.seconds;
+    stamp.micros = t.micros;
+}
+
+// Stores a reading of sensor i taken just now in the registry and
+// updates the masks
+static void store(uint8_t i, bool ok, const SensorReading &reading, uint8_t &fresh, uint8_t &failed)
+{
+    if (!ok)
+    {
+        failed |= 1 << i;
+        return;
+    }
+    Sensor &s = sensorAt(i);
+    s.failStreak = 0;
+    s.valid = true;
+    s.reading = reading;
+    s.readingMs = millis();
+    samplerStamp(s.stamp);
+    fresh |= 1 << i;
+}
+
+// Reads sensor i into the registry. Called right after the status poll
+// saw the conversion finish, which is the stamp.
+static void fetch(uint8_t i, uint8_t &fresh, uint8_t &failed)
+{
+    SensorReading reading;
+    bool ok = sensorAt(i).bme.read(reading);
+    store(i, ok, reading, fresh, failed);
+}
+
+static inline void earliest(uint32_t &next, uint32_t at)
+{
+    if ((int32_t)(at - next) < 0)
+    {
+        next = at;
+    }
+}
+
+static uint8_t pollForced(uint32_t now, uint8_t &failed)
+{
+    const uint32_t periodUs = (uint32_t)samplerPeriodMs() * 1000UL;
+    uint8_t fresh = 0;
+    if (state == SAMPLER_IDLE)
+    {
+        // Fixed-rate trigger clock; missed periods are dropped, not replayed
+        nextTrigger += periodUs;
+        if (timeReached(now, nextTrigger))
+        {
+            nextTrigger = now + periodUs;
+        }
+        // Trigger everything first, so the conversions run in parallel
+        uint32_t waitUs = 0;
+        for (uint8_t i = 0; i < sensorCount(); i++)
+        {
+            Sensor &s = sensorAt(i);
+            if (!s.ready)
+            {
+                continue;
+            }
+            if (s.bme.startForced())
+            {
+                pending |= 1 << i;
+                waitUs = max(waitUs, s.bme.measurementTimeUs());
+            }
+            else
+            {
+                failed |= 1 << i;
+            }
+        }
+        if (pending == 0)
+        {
+            nextPoll = nextTrigger;
+            return 0;
+        }
+        state = SAMPLER_CONVERTING;
+        nextPoll = now + waitUs;
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        if (!(pending & (1 << i)))
+        {
+            continue;
+        }
+        uint8_t status;
+        if (!sensorAt(i).bme.readStatus(status))
+        {
+            pending &= ~(1 << i);
+            failed |= 1 << i;
+            continue;
+        }
+        if (status & BME280_STATUS_MEASURING)
+        {
+            continue;
+        }
+        pending &= ~(1 << i);
+        fetch(i, fresh, failed);
+    }
+    if (pending)
+    {
+        nextPoll = now + FORCED_RECHECK_US;
+        return fresh;
+    }
+    state = SAMPLER_IDLE;
+    nextPoll = nextTrigger;
+    return fresh;
+}
+
+// Normal mode: the measuring bit is clear only for t_sb per cycle (0.5 ms
+// in the fast profile), so polls would miss most of those windows.
+// Instead the data registers are read once a typical cycle has passed
+// since the last reading. Shadowing keeps them coherent while the next
+// conversion runs. A frame that changed is a new conversion. An
+// unchanged one is taken too once a worst-case cycle has passed, because
+// a conversion has certainly completed by then.
+static uint8_t pollNormal(uint32_t now, uint8_t &failed)
+{
+    const uint32_t periodUs = (uint32_t)samplerPeriodMs() * 1000UL;
+    uint32_t next = now + NORMAL_MAX_WAIT_US;
+    uint8_t fresh = 0;
+    for (uint8_t i = 0; i < sensorCount() && i < SENSOR_MAX; i++)
+    {
+        Sensor &s = sensorAt(i);
+        if (!s.ready)
+        {
+            continue;
+        }
+        if (!timeReached(now, dueUs[i]))
+        {
+            earliest(next, dueUs[i]);
+            continue;
+        }
+        uint32_t t = profilerStart();
+        BmeRawFrame frame;
+        if (!s.bme.readFrame(frame))
+        {
+            failed |= 1 << i;
+            earliest(next, now + periodUs);
+            continue;
+        }
+        profilerStop(PROF_SENSOR_READ, t);
+        if (memcmp(&frame, &lastFrame[i], sizeof(frame)) == 0 && !timeReached(now, certainUs[i]))
+        {
+            earliest(next, now + periodUs); // the conversion is still running
+            continue;
+        }
+        lastFrame[i] = frame;
+        // Opened one poll early, so a part faster than typical is not overtaken
+        uint32_t standby = s.bme.standbyTimeUs();
+        uint32_t cycle = s.bme.typicalMeasurementTimeUs() + standby;
+        dueUs[i] = now + max(periodUs, cycle > periodUs ? cycle - periodUs : 0);
+        certainUs[i] = now + s.bme.measurementTimeUs() + standby + standby / 16; // t_sb tolerance
+        earliest(next, dueUs[i]);
+        t = profilerStart();
+        SensorReading reading;
+        bool ok = s.bme.compensate(frame, reading);
+        profilerStop(PROF_COMPENSATE, t);
+        store(i, ok, reading, fresh, failed);
+    }
+    nextPoll = next;
+    return fresh;
+}
+
+uint8_t samplerPoll(uint32_t nowUs, uint8_t &failed)
+{
+    failed = 0;
+    if (sensorsReady() == 0 || !timeReached(nowUs, nextPoll))
+    {
+        return 0;
+    }
+    if (paused)
+    {
+        nextPoll = nowUs + PAUSED_POLL_US;
+        return 0;
+    }
+    uint8_t fresh;
+    if (samplingProfiles[current].config.mode == BME280_MODE_FORCED)
+    {
+        fresh = pollForced(nowUs, failed);
+    }
+    else
+    {
+        fresh = pollNormal(nowUs, failed);
+    }
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        Sensor &s = sensorAt(i);
+        if (!(failed & (1 << i)))
+        {
+            continue;
+        }
+        s.valid = false;
+        if (++s.failStreak >= SENSOR_OFFLINE_FAILS)
+        {
+            s.ready = false;
+            s.backoffMs = SENSOR_BACKOFF_MIN_MS;
+            s.retryMs = millis() + s.backoffMs;
+            pending &= ~(1 << i);
+        }
+    }
+    return fresh;
+}
+
+uint32_t samplerNextPollUs()
+{
+    return nextPoll;
+}
+
+uint8_t samplerReconnect(uint32_t nowMs)
+{
+    uint8_t back = 0;
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        Sensor &s = sensorAt(i);
+        if (s.backoffMs == 0 || s.bus->faulted || !timeReached(nowMs, s.retryMs))
+        {
+            continue;
+        }
+        // The sensor may have reset: fresh calibration and configuration
+        if (s.bme.begin(s.addr, s.bus->wire) && s.bme.configure(samplingProfiles[current].config))
+        {
+            s.ready = true;
+            s.failStreak = 0;
+            s.backoffMs = 0;
+            back |= 1 << i;
+            continue;
+        }
+        s.backoffMs = (uint16_t)min(s.backoffMs * 2, SENSOR_BACKOFF_MAX_MS);
+        s.retryMs = nowMs + s.backoffMs;
+    }
+    if (back)
+    {
+        restart();
+    }
+    return back;
+}
+
+bool samplerNextReconnectMs(uint32_t &atMs)
+{
+    bool any = false;
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        const Sensor &s = sensorAt(i);
+        if (s.backoffMs == 0 || s.bus->faulted)
+        {
+            continue; // a faulted bus is retried first, see samplerReconnectBus()
+        }
+        if (!any || (int32_t)(s.retryMs - atMs) < 0)
+        {
+            atMs = s.retryMs;
+        }
+        any = true;
+    }
+    return any;
+}
+
+void samplerReconnectBus(const I2cBus *bus)
+{
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < sensorCount(); i++)
+    {
+        Sensor &s = sensorAt(i);
+        if (s.bus != bus || !(s.ready || s.backoffMs))
+        {
+            continue; // never came up; probeTask keeps trying those
+        }
+        s.ready = false;
+        s.valid = false;
+        s.backoffMs = SENSOR_BACKOFF_MIN_MS;
+        s.retryMs = now;
+        pending &= ~(1 << i);
+    }
+}
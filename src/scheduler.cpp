@@ -0,0 +1,169 @@
+#include "scheduler.h"
+
+struct Task
+{
+    const char *name;
+    TaskFunction fn;
+    uint32_t periodUs; // 0 for event tasks
+    uint32_t deadline; // next run time (micros) when armed
+    bool armed;
+    bool enabled;
+    volatile bool signalled;
+};
+
+static Task tasks[SCHEDULER_MAX_TASKS];
+static int taskCount = 0;
+
+// Wrap-safe "a is at or after b" for micros() timestamps
+static inline bool timeReached(uint32_t now, uint32_t deadline)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static int addTask(const char *name, TaskFunction fn, uint32_t periodUs)
+{
+    if (taskCount >= SCHEDULER_MAX_TASKS)
+    {
+        return -1;
+    }
+    Task &t = tasks[taskCount];
+    t.name = name;
+    t.fn = fn;
+    t.periodUs = periodUs;
+    t.deadline = micros() + periodUs;
+    t.armed = (periodUs != 0);
+    t.enabled = true;
+    t.signalled = false;
+    return taskCount++;
+}
+
+int schedulerAddPeriodic(const char *name, TaskFunction fn, uint32_t periodUs)
+{
+    return addTask(name, fn, periodUs == 0 ? 1 : periodUs);
+}
+
+int schedulerAddEvent(const char *name, TaskFunction fn)
+{
+    return addTask(name, fn, 0);
+}
+
+void schedulerSignal(int id)
+{
+    if (id >= 0 && id < taskCount)
+    {
+        tasks[id].signalled = true;
+    }
+}
+
+void schedulerWakeAt(int id, uint32_t deadlineUs)
+{
+    if (id >= 0 && id < taskCount)
+    {
+        tasks[id].deadline = deadlineUs;
+        tasks[id].armed = true;
+    }
+}
+
+void schedulerWakeIn(int id, uint32_t delayUs)
+{
+    schedulerWakeAt(id, micros() + delayUs);
+}
+
+void schedulerSetPeriod(int id, uint32_t periodUs)
+{
+    if (id >= 0 && id < taskCount && tasks[id].periodUs != 0 && periodUs != 0)
+    {
+        tasks[id].periodUs = periodUs;
+    }
+}
+
+void schedulerEnable(int id, bool enabled)
+{
+    if (id < 0 || id >= taskCount)
+    {
+        return;
+    }
+    Task &t = tasks[id];
+    if (enabled && !t.enabled && t.periodUs != 0)
+    {
+        t.deadline = micros(); // restart the clock: run on the next pass
+        t.armed = true;
+    }
+    t.enabled = enabled;
+}
+
+bool schedulerRun()
+{
+    bool ran = false;
+    for (int i = 0; i < taskCount; i++)
+    {
+        Task &t = tasks[i];
+        if (!t.enabled)
+        {
+            continue;
+        }
+        uint32_t now = micros();
+        bool due = t.armed && timeReached(now, t.deadline);
+        if (!due && !t.signalled)
+        {
+            continue;
+        }
+        t.signalled = false;
+        if (due)
+        {
+            if (t.periodUs != 0)
+            {
+                // Fixed-rate: advance from the old deadline. If we fell more
+                // than a whole period behind, drop the missed ticks instead of
+                // running them back to back.
+                t.deadline += t.periodUs;
+                if (timeReached(now, t.deadline))
+                {
+                    t.deadline = now + t.periodUs;
+                }
+            }
+            else
+            {
+                t.armed = false;
+            }
+        }
+        t.fn(now);
+        ran = true;
+    }
+    return ran;
+}
+
+uint32_t schedulerTimeToNextUs()
+{
+    uint32_t now = micros();
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < taskCount; i++)
+    {
+        const Task &t = tasks[i];
+        if (!t.enabled)
+        {
+            continue;
+        }
+        if (t.signalled || (t.armed && timeReached(now, t.deadline)))
+        {
+            return 0;
+        }
+        if (t.armed && (t.deadline - now) < best)
+        {
+            best = t.deadline - now;
+        }
+    }
+    return best;
+}
+
+void schedulerIdle()
+{
+#if defined(ARDUINO_ARCH_STM32)
+    // SysTick fires every millisecond, so this never oversleeps a deadline
+    // by more than one tick; EXTI and USB interrupts also wake the core.
+    if (schedulerTimeToNextUs() > 1000)
+    {
+        __WFI();
+    }
+#endif
+}
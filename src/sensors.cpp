@@ -0,0 +1,70 @@
+#include "sensors.h"
+
+static Sensor sensors[SENSOR_MAX];
+static uint8_t count = 0;
+
+int sensorsAdd(I2cBus *bus, uint8_t busNumber, uint8_t addr)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (sensors[i].bus == bus && sensors[i].addr == addr)
+        {
+            return i;
+        }
+    }
+    if (count >= SENSOR_MAX)
+    {
+        return -1;
+    }
+    Sensor &s = sensors[count];
+    s.bus = bus;
+    s.busNumber = busNumber;
+    s.addr = addr;
+    s.ready = false;
+    s.valid = false;
+    s.readingMs = 0;
+    memset(&s.stamp, 0, sizeof(s.stamp));
+    s.failStreak = 0;
+    s.backoffMs = 0;
+    s.retryMs = 0;
+    return count++;
+}
+
+uint8_t sensorsDiscover(I2cBus *bus, uint8_t busNumber)
+{
+    static const uint8_t addresses[] = {0x76, 0x77};
+    for (uint8_t i = 0; i < sizeof(addresses); i++)
+    {
+        if (i2cProbeBme280(bus->wire, addresses[i]))
+        {
+            sensorsAdd(bus, busNumber, addresses[i]);
+        }
+    }
+    return count;
+}
+
+uint8_t sensorCount()
+{
+    return count;
+}
+
+Sensor &sensorAt(uint8_t index)
+{
+    return sensors[index < count ? index : 0];
+}
+
+uint8_t sensorsReady()
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        n += sensors[i].ready ? 1 : 0;
+    }
+    return n;
+}
+
+void sensorLabel(uint8_t index, char *buf, size_t size)
+{
+    const Sensor &s = sensorAt(index);
+    snprintf(buf, size, "%u:%02X", s.busNumber, s.addr);
+}
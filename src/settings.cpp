@@ -0,0 +1,238 @@
+#include "settings.h"
+#include "sampler.h"
+#include "telemetry.h"
+#include "button.h"
+#include "rtc_time.h"
+
+#if defined(ARDUINO_ARCH_STM32) && defined(STM32F4xx)
+#define SETTINGS_FLASH 1
+#endif
+
+#define SETTINGS_SECTOR_BASE 0x08060000
+#define SETTINGS_SECTOR_SIZE 0x20000
+#define SETTINGS_ERASED 0xFFFFFFFF
+
+struct StoredSettings
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    Settings data;
+    uint16_t crc;
+};
+
+// Records take fixed, word-aligned slots, so they program word by word
+#define SETTINGS_SLOT_WORDS ((sizeof(StoredSettings) + 3) / 4)
+#define SETTINGS_SLOTS (SETTINGS_SECTOR_SIZE / (SETTINGS_SLOT_WORDS * 4))
+
+Settings settings;
+
+static bool dirty = false;
+static void (*dirtyHook)() = nullptr;
+
+void settingsDefaults(Settings &s)
+{
+    s.profile = PROFILE_WEATHER;
+    s.telemetryFormat = TELEMETRY_DEFAULT_FORMAT;
+    s.debounceMs = BUTTON_DEBOUNCE_MS;
+    s.periodMs = 0;
+    s.filter = FILTER_DEFAULT_CONFIG;
+    s.rtcPpm = 0;
+    s.derived = DERIVED_DEFAULT_CONFIG;
+}
+
+#ifdef SETTINGS_FLASH
+// Keeps value if it lies in lo..hi, else takes the default
+template <typename T>
+static void checkRange(T &value, int32_t lo, int32_t hi, T fallback)
+{
+    if ((int64_t)value < lo || (int64_t)value > hi)
+    {
+        value = fallback;
+    }
+}
+
+// Holds a loaded record to the console's ranges, field by field
+static void validate(Settings &s)
+{
+    Settings d;
+    settingsDefaults(d);
+    checkRange(s.profile, 0, PROFILE_COUNT - 1, d.profile);
+    checkRange(s.telemetryFormat, TELEMETRY_TEXT, TELEMETRY_BINARY, d.telemetryFormat);
+    checkRange(s.debounceMs, SETTINGS_DEBOUNCE_MS_MIN, SETTINGS_DEBOUNCE_MS_MAX, d.debounceMs);
+    checkRange(s.periodMs, 0, SETTINGS_PERIOD_MS_MAX, d.periodMs);
+    checkRange(s.filter.mode, 0, FILTER_MODES - 1, d.filter.mode);
+    checkRange(s.filter.emaShift, 1, FILTER_EMA_SHIFT_MAX, d.filter.emaShift);
+    for (uint8_t c = 0; c < FILTER_CHANNELS; c++)
+    {
+        checkRange(s.filter.deadband[c], 0, SETTINGS_DEADBAND_MAX, d.filter.deadband[c]);
+    }
+    checkRange(s.filter.heartbeatS, 0, SETTINGS_REPORT_S_MAX, d.filter.heartbeatS);
+    checkRange(s.rtcPpm, -RTC_CALIBRATION_MAX_PPM, RTC_CALIBRATION_MAX_PPM, d.rtcPpm);
+    checkRange(s.derived.qnhPa, SETTINGS_QNH_PA_MIN, SETTINGS_QNH_PA_MAX, d.derived.qnhPa);
+    checkRange(s.derived.elevationM, SETTINGS_ELEVATION_M_MIN, SETTINGS_ELEVATION_M_MAX, d.derived.elevationM);
+    for (uint8_t o = 0; o < FILTER_OUTPUTS; o++)
+    {
+        checkRange(s.derived.outputs[o], 0, DERIVED_ALL, d.derived.outputs[o]);
+    }
+}
+
+static int32_t newest = -1;   // slot of the record in force, -1 if none
+static uint32_t nextSlot = 0; // first blank slot after every used one
+
+static const StoredSettings *slot(uint32_t i)
+{
+    return (const StoredSettings *)(SETTINGS_SECTOR_BASE + i * SETTINGS_SLOT_WORDS * 4);
+}
+
+static bool slotBlank(uint32_t i)
+{
+    const uint32_t *w = (const uint32_t *)slot(i);
+    for (size_t k = 0; k < SETTINGS_SLOT_WORDS; k++)
+    {
+        if (w[k] != SETTINGS_ERASED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint16_t blockCrc(const StoredSettings &block)
+{
+    return telemetryCrc16((const uint8_t *)&block, offsetof(StoredSettings, crc));
+}
+
+static bool blockValid(const StoredSettings &block)
+{
+    return block.magic == SETTINGS_MAGIC && block.version == SETTINGS_VERSION &&
+           block.length == sizeof(Settings) && block.crc == blockCrc(block);
+}
+
+static void flashUnlock()
+{
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+}
+
+// Blocks for about a second: code runs from flash, so interrupts stall too
+static bool eraseSector()
+{
+    FLASH_EraseInitTypeDef erase = {};
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = FLASH_SECTOR_7;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    uint32_t bad = 0;
+    flashUnlock();
+    bool ok = HAL_FLASHEx_Erase(&erase, &bad) == HAL_OK;
+    HAL_FLASH_Lock();
+    return ok;
+}
+
+// In address order, so the CRC is programmed last and a record cut short
+// by a reset never checks out
+static bool programSlot(uint32_t i, const uint32_t *words)
+{
+    uintptr_t addr = (uintptr_t)slot(i);
+    bool ok = true;
+    flashUnlock();
+    for (size_t k = 0; k < SETTINGS_SLOT_WORDS && ok; k++)
+    {
+        ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t)(addr + k * 4), words[k]) == HAL_OK;
+    }
+    HAL_FLASH_Lock();
+    return ok;
+}
+#endif
+
+bool settingsLoad()
+{
+    settingsDefaults(settings);
+#ifdef SETTINGS_FLASH
+    // The sector is memory mapped; a scan stops at the first blank slot
+    newest = -1;
+    for (nextSlot = 0; nextSlot < SETTINGS_SLOTS && !slotBlank(nextSlot); nextSlot++)
+    {
+        if (blockValid(*slot(nextSlot)))
+        {
+            newest = (int32_t)nextSlot;
+        }
+    }
+    if (newest < 0)
+    {
+        return false;
+    }
+    memcpy(&settings, &slot(newest)->data, sizeof(Settings));
+    validate(settings);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void settingsMarkDirty()
+{
+    dirty = true;
+    if (dirtyHook)
+    {
+        dirtyHook();
+    }
+}
+
+void settingsOnDirty(void (*hook)())
+{
+    dirtyHook = hook;
+}
+
+bool settingsDirty()
+{
+    return dirty;
+}
+
+bool settingsCommit()
+{
+    if (!dirty)
+    {
+        return true;
+    }
+#ifdef SETTINGS_FLASH
+    StoredSettings block;
+    memset(&block, 0, sizeof(block));
+    block.magic = SETTINGS_MAGIC;
+    block.version = SETTINGS_VERSION;
+    block.length = sizeof(Settings);
+    memcpy(&block.data, &settings, sizeof(Settings)); // Padding included, for the compare
+    block.crc = blockCrc(block);
+    uint32_t words[SETTINGS_SLOT_WORDS];
+    memset(words, 0xFF, sizeof(words)); // The tail of the slot stays erased
+    memcpy(words, &block, sizeof(block));
+
+    if (newest >= 0 && memcmp(slot(newest), &block, sizeof(block)) == 0)
+    {
+        dirty = false; // Same as the record in force
+        return true;
+    }
+    if (nextSlot >= SETTINGS_SLOTS)
+    {
+        if (!eraseSector())
+        {
+            return false;
+        }
+        nextSlot = 0;
+        newest = -1;
+    }
+    if (!programSlot(nextSlot, words) || memcmp(slot(nextSlot), &block, sizeof(block)) != 0)
+    {
+        nextSlot++; // Never program a slot twice
+        return false;
+    }
+    newest = (int32_t)nextSlot++;
+    dirty = false; // Only once the record reads back
+    return true;
+#else
+    dirty = false; // Nowhere to keep them
+    return false;
+#endif
+}
@@ -0,0 +1,184 @@
+#include "status_pages.h"
+#include "oled_renderer.h"
+#include "fixed_format.h"
+#include "history.h"
+#include "i2c_bus.h"
+#include "sensors.h"
+#include "profiler.h"
+#include "derived.h"
+
+static char rows[OLED_PAGES][STATUS_COLUMNS + 1];
+static bool changed = false;
+
+static void begin(bool full)
+{
+    if (full)
+    {
+        oledRendererClear();
+        memset(rows, 0, sizeof(rows));
+        changed = true;
+        return;
+    }
+    changed = false;
+}
+
+// Sets a text row, padded to the full width so shorter text clears the rest
+static void row(uint8_t page, const char *text)
+{
+    char padded[STATUS_COLUMNS + 1];
+    snprintf(padded, sizeof(padded), "%-*s", STATUS_COLUMNS, text);
+    if (strcmp(padded, rows[page]) == 0)
+    {
+        return;
+    }
+    oledRendererText(page, 0, padded);
+    memcpy(rows[page], padded, sizeof(padded));
+    changed = true;
+}
+
+static void rangeRow(uint8_t page, const char *label, HistoryChannel channel, int32_t divisor, uint8_t decimals)
+{
+    HistoryStats st = historyStats(channel);
+    char text[STATUS_COLUMNS + 1];
+    if (st.count == 0)
+    {
+        snprintf(text, sizeof(text), "%-6s--", label);
+        row(page, text);
+        return;
+    }
+    char lo[10], hi[10];
+    formatFixed(lo, sizeof(lo), divRound(st.min, divisor), decimals);
+    formatFixed(hi, sizeof(hi), divRound(st.max, divisor), decimals);
+    snprintf(text, sizeof(text), "%-6s%s..%s", label, lo, hi);
+    row(page, text);
+}
+
+bool statusPageDerived(uint8_t arg, bool full)
+{
+    begin(full);
+    char text[STATUS_COLUMNS + 1];
+    char tag[SENSOR_LABEL_LEN];
+    sensorLabel(arg, tag, sizeof(tag));
+    snprintf(text, sizeof(text), "Derived %s", sensorCount() > 1 ? tag : "");
+    row(0, text);
+    const Sensor &sensor = sensorAt(arg);
+    uint8_t page = 2;
+    uint8_t mask = derivedOutputs(FILTER_OUT_DISPLAY);
+    const DerivedValues *v = sensor.valid ? &derivedFor(FILTER_OUT_DISPLAY, arg, sensor.reading) : nullptr;
+    for (uint8_t m = 0; m < DERIVED_METRICS && page < OLED_PAGES; m++)
+    {
+        if (!(mask & DERIVED_BIT(m)))
+        {
+            continue;
+        }
+        const DerivedInfo &info = derivedInfo((DerivedMetric)m);
+        char value[12] = "--";
+        if (v)
+        {
+            formatFixed(value, sizeof(value), v->value[m], 2);
+        }
+        snprintf(text, sizeof(text), "%-7s%9s %s", info.label, value, info.unit);
+        row(page++, text);
+    }
+    while (page < OLED_PAGES)
+    {
+        row(page++, "");
+    }
+    return changed;
+}
+
+bool statusPageDerivedAvailable(uint8_t arg)
+{
+    return derivedOutputs(FILTER_OUT_DISPLAY) != 0 && arg < sensorCount();
+}
+
+bool statusPageStats(uint8_t arg, bool full)
+{
+    (void)arg;
+    begin(full);
+    char text[STATUS_COLUMNS + 1];
+    snprintf(text, sizeof(text), "History  n %u", historyCount());
+    row(0, text);
+    rangeRow(2, "Temp", HIST_TEMPERATURE, 1, 2);
+    rangeRow(3, "Hum", HIST_HUMIDITY, 1, 2);
+    rangeRow(4, "Press", HIST_PRESSURE, 10, 1); // Pa -> 0.1 mBar
+    HistoryStats t = historyStats(HIST_TEMPERATURE);
+    char mean[10] = "--";
+    if (t.count)
+    {
+        formatFixed(mean, sizeof(mean), t.mean, 2);
+    }
+    snprintf(text, sizeof(text), "Mean T %s C", mean);
+    row(5, text);
+    int32_t trend;
+    char value[10] = "n/a";
+    if (historyPressureTrend(trend))
+    {
+        formatFixed(value, sizeof(value), divRound(trend, 10), 1);
+    }
+    snprintf(text, sizeof(text), "Trend %s mBar/3h", value);
+    row(7, text);
+    return changed;
+}
+
+bool statusPageHealth(uint8_t arg, bool full)
+{
+    (void)arg;
+    begin(full);
+    row(0, "Bus health");
+    char text[STATUS_COLUMNS + 1];
+    uint8_t page = 1;
+    for (uint8_t b = 0; b < i2cBusCount() && page + 1 < OLED_PAGES; b++)
+    {
+        const I2cBus &bus = i2cBusAt(b);
+        snprintf(text, sizeof(text), "I2C%u %luk %s r%u", b + 1, (unsigned long)(i2cBusClock(bus) / 1000),
+                 bus.faulted ? "FAULT" : "ok", bus.health.recoveries);
+        row(page++, text);
+        snprintf(text, sizeof(text), " n%u t%u e%u", bus.health.nacks, bus.health.timeouts, bus.health.errors);
+        row(page++, text);
+    }
+    // Two sensors per row: "1:76 ok  2:77 off"
+    for (uint8_t i = 0; i < sensorCount() && page < OLED_PAGES; i += 2)
+    {
+        char a[12], b[12] = "";
+        char tag[SENSOR_LABEL_LEN];
+        sensorLabel(i, tag, sizeof(tag));
+        snprintf(a, sizeof(a), "%s %s", tag, sensorAt(i).ready ? "ok" : "off");
+        if (i + 1 < sensorCount())
+        {
+            sensorLabel(i + 1, tag, sizeof(tag));
+            snprintf(b, sizeof(b), "%s %s", tag, sensorAt(i + 1).ready ? "ok" : "off");
+        }
+        snprintf(text, sizeof(text), "%-9s%s", a, b);
+        row(page++, text);
+    }
+    while (page < OLED_PAGES)
+    {
+        row(page++, ""); // a bus or sensor that is gone leaves no stale row
+    }
+    return changed;
+}
+
+bool statusPageProfile(uint8_t arg, bool full)
+{
+    (void)arg;
+    begin(full);
+    row(0, "Profile  mean/max us");
+    char text[STATUS_COLUMNS + 1];
+    for (uint8_t i = 0; i < PROF_SECTIONS && i + 1 < OLED_PAGES; i++)
+    {
+        const ProfileStats &st = profilerStats((ProfileSection)i);
+        if (st.count == 0)
+        {
+            snprintf(text, sizeof(text), "%-8.8s     -", profilerName((ProfileSection)i));
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%-8.8s %5lu %6lu", profilerName((ProfileSection)i),
+                     (unsigned long)profilerCyclesToUs(st.totalCycles / st.count),
+                     (unsigned long)profilerCyclesToUs(st.maxCycles));
+        }
+        row(i + 1, text);
+    }
+    return changed;
+}
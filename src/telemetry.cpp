@@ -0,0 +1,203 @@
+#include "telemetry.h"
+#include "fixed_format.h"
+
+static TelemetryFormat format = TELEMETRY_DEFAULT_FORMAT;
+static uint16_t sequence = 0;
+
+void telemetrySetFormat(TelemetryFormat f)
+{
+    format = f;
+}
+
+TelemetryFormat telemetryFormat()
+{
+    return format;
+}
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+uint16_t telemetryCrc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t telemetryCobsEncode(const uint8_t *data, size_t len, uint8_t *out)
+{
+    size_t codeIndex = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (data[i] == 0)
+        {
+            out[codeIndex] = code;
+            codeIndex = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = data[i];
+        if (++code == 0xFF)
+        {
+            out[codeIndex] = code;
+            codeIndex = o++;
+            code = 1;
+        }
+    }
+    out[codeIndex] = code;
+    out[o++] = 0x00; // frame delimiter
+    return o;
+}
+
+// ">Name:" or ">Name_<sensor>:" for the secondary sensors
+static void printKey(Print &out, const char *name, uint8_t sensor)
+{
+    out.print('>');
+    out.print(name);
+    if (sensor)
+    {
+        out.print('_');
+        out.print(sensor);
+    }
+    out.print(':');
+}
+
+void telemetryWriteFrame(Print &out, uint8_t *pkt, size_t len)
+{
+    put16(&pkt[len - 2], telemetryCrc16(pkt, len - 2));
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t n = telemetryCobsEncode(pkt, len, frame);
+    out.write(frame, n);
+}
+
+static void writeText(Print &out, const SensorReading &r, uint8_t sensor)
+{
+    printKey(out, "Pressure", sensor);
+    // Q24.8 Pa -> 1e-5 mBar: x * 100000 / (256 * 100)
+    printFixed(out, (int32_t)(((uint64_t)r.pressure * 1000 + 128) >> 8), 5);
+    out.println("§mBar"); // Corrected unit symbol
+    printKey(out, "Temp", sensor);
+    printFixed(out, divRound(r.temperature, 10), 1);
+    out.println("§C"); // Corrected unit symbol
+    printKey(out, "Hum", sensor);
+    printFixed(out, (int32_t)((r.humidity * 10 + 512) >> 10), 1);
+    out.println("§%"); // Corrected unit symbol
+}
+
+static void writeBinary(Print &out, const SensorReading &r, const SampleStamp &stamp, uint8_t sensor)
+{
+    uint8_t pkt[TELEMETRY_SAMPLE_LEN];
+    pkt[0] = TELEMETRY_PKT_SAMPLE;
+    put16(&pkt[1], sequence);
+    put32(&pkt[3], stamp.sequence);
+    put32(&pkt[7], stamp.seconds);
+    put32(&pkt[11], stamp.micros);
+    put16(&pkt[15], (uint16_t)(int16_t)r.temperature);
+    put32(&pkt[17], r.pressure);
+    put16(&pkt[21], (uint16_t)humidityCenti(r.humidity));
+    pkt[23] = sensor;
+    telemetryWriteFrame(out, pkt, sizeof(pkt));
+}
+
+void telemetryWriteSample(Print &out, const SensorReading &reading, const SampleStamp &stamp, uint8_t sensor)
+{
+    if (format == TELEMETRY_BINARY)
+    {
+        writeBinary(out, reading, stamp, sensor);
+    }
+    else
+    {
+        writeText(out, reading, sensor);
+    }
+    sequence++; // counts samples in both formats so a switch keeps the gap visible
+}
+
+void telemetryWriteDerived(Print &out, const DerivedValues &values, const SampleStamp &stamp, uint8_t sensor)
+{
+    if (values.mask == 0)
+    {
+        return;
+    }
+    if (format == TELEMETRY_BINARY)
+    {
+        uint8_t pkt[9 + 4 * DERIVED_METRICS];
+        pkt[0] = TELEMETRY_PKT_DERIVED;
+        put32(&pkt[1], stamp.sequence);
+        pkt[5] = sensor;
+        pkt[6] = values.mask;
+        size_t len = 7;
+        for (uint8_t m = 0; m < DERIVED_METRICS; m++)
+        {
+            if (values.mask & DERIVED_BIT(m))
+            {
+                put32(&pkt[len], (uint32_t)values.value[m]);
+                len += 4;
+            }
+        }
+        telemetryWriteFrame(out, pkt, len + 2);
+        return;
+    }
+    for (uint8_t m = 0; m < DERIVED_METRICS; m++)
+    {
+        if (values.mask & DERIVED_BIT(m))
+        {
+            const DerivedInfo &info = derivedInfo((DerivedMetric)m);
+            printKey(out, info.name, sensor);
+            printFixed(out, values.value[m], 2);
+            out.print("§");
+            out.println(info.unit);
+        }
+    }
+}
+
+static void printCounter(Print &out, uint8_t busNumber, const char *name, uint32_t value)
+{
+    out.print(F(">I2C"));
+    out.print(busNumber);
+    out.print('_');
+    out.print(name);
+    out.print(':');
+    out.println(value);
+}
+
+void telemetryWriteHealth(Print &out, uint8_t busNumber, const I2cHealth &h, uint32_t clockHz, uint32_t timestampMs)
+{
+    if (format == TELEMETRY_BINARY)
+    {
+        uint8_t pkt[TELEMETRY_HEALTH_LEN];
+        pkt[0] = TELEMETRY_PKT_HEALTH;
+        pkt[1] = busNumber;
+        put32(&pkt[2], timestampMs);
+        put32(&pkt[6], h.transactions);
+        put16(&pkt[10], h.nacks);
+        put16(&pkt[12], h.timeouts);
+        put16(&pkt[14], h.errors);
+        put16(&pkt[16], h.recoveries);
+        put16(&pkt[18], (uint16_t)(clockHz / 1000));
+        telemetryWriteFrame(out, pkt, sizeof(pkt));
+        return;
+    }
+    printCounter(out, busNumber, "xfer", h.transactions);
+    printCounter(out, busNumber, "nack", h.nacks);
+    printCounter(out, busNumber, "timeout", h.timeouts);
+    printCounter(out, busNumber, "error", h.errors);
+    printCounter(out, busNumber, "recover", h.recoveries);
+}
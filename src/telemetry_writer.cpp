@@ -0,0 +1,114 @@
+#include "telemetry_writer.h"
+#include "telemetry.h"
+
+TelemetryWriter telemetryWriter;
+
+void TelemetryWriter::begin(Print &p)
+{
+    port = &p;
+    tail = 0;
+    used = 0;
+#ifdef USE_FREERTOS
+    mutex = xSemaphoreCreateMutex();
+#endif
+}
+
+// Only once the RTOS runs; before that setup() is the only writer
+void TelemetryWriter::lock()
+{
+#ifdef USE_FREERTOS
+    if (mutex && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+    {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+#endif
+}
+
+void TelemetryWriter::unlock()
+{
+#ifdef USE_FREERTOS
+    if (mutex && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+    {
+        xSemaphoreGive(mutex);
+    }
+#endif
+}
+
+size_t TelemetryWriter::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t TelemetryWriter::write(const uint8_t *data, size_t len)
+{
+    if (len > sizeof(buffer))
+    {
+        droppedFrames++;
+        return 0;
+    }
+    lock();
+    while (sizeof(buffer) - used < len)
+    {
+        dropOldest();
+    }
+    size_t head = (tail + used) % sizeof(buffer);
+    size_t first = min(len, sizeof(buffer) - head);
+    memcpy(&buffer[head], data, first);
+    memcpy(buffer, data + first, len - first);
+    used += (uint16_t)len;
+    unlock();
+    return len;
+}
+
+void TelemetryWriter::dropOldest()
+{
+    const uint8_t delimiter = telemetryFormat() == TELEMETRY_BINARY ? 0x00 : '\n';
+    uint16_t n = 0;
+    while (n < used && buffer[(tail + n) % sizeof(buffer)] != delimiter)
+    {
+        n++;
+    }
+    n = (uint16_t)min<uint16_t>(n + 1, used); // the delimiter goes with its frame
+    tail = (uint16_t)((tail + n) % sizeof(buffer));
+    used -= n;
+    droppedFrames++;
+}
+
+void TelemetryWriter::poll()
+{
+    if (!held)
+    {
+        lock();
+        send();
+        unlock();
+    }
+}
+
+void TelemetryWriter::send()
+{
+    if (!port || used == 0)
+    {
+        return;
+    }
+    size_t room = (size_t)max(port->availableForWrite(), 0);
+    size_t n = used <= room ? used : room - room % TELEMETRY_USB_PACKET;
+    while (n > 0)
+    {
+        size_t chunk = min(n, sizeof(buffer) - tail); // contiguous part up to the wrap
+        port->write(&buffer[tail], chunk);
+        tail = (uint16_t)((tail + chunk) % sizeof(buffer));
+        used -= (uint16_t)chunk;
+        n -= chunk;
+    }
+}
+
+void TelemetryWriter::drain(uint32_t timeoutMs)
+{
+    uint32_t start = millis();
+    while (used != 0 && (millis() - start) < timeoutMs)
+    {
+        lock();
+        send();
+        unlock();
+    }
+}
@@ -0,0 +1,121 @@
+#include "trend_graph.h"
+#include "oled_renderer.h"
+#include "fixed_format.h"
+
+struct ChannelStyle
+{
+    const char *label;
+    const char *unit;
+    int32_t minSpan; // smallest scale, so sensor noise does not fill the plot
+};
+
+// History values are all in hundredths of their display unit (Pa == centi-mBar)
+static const ChannelStyle styles[HIST_CHANNELS] = {
+    {"Temp", " C", 50},      // 0.5 C
+    {"Hum", " %", 200},      // 2 %RH
+    {"Press", " mBar", 100}, // 1 mBar
+};
+static constexpr uint8_t VALUE_CHARS = 7; // 1013.25
+
+static HistoryChannel shownChannel = HIST_TEMPERATURE;
+static uint32_t drawnTotal = 0; // historyTotal() when the last column was drawn
+static uint8_t cursor = 0;      // column the next sample goes into
+static int8_t lastRow = -1;     // row of the newest plotted sample, -1 for none
+static int32_t scaleMin = 0;
+static int32_t scaleMax = 1;
+static char lastTitle[24];
+
+// Range wanted for the current statistics: at least minSpan, with a
+// quarter of headroom so small excursions do not force a redraw
+static void wantedScale(const HistoryStats &st, int32_t &lo, int32_t &hi)
+{
+    int32_t span = max(st.max - st.min, styles[shownChannel].minSpan);
+    span += span / 4;
+    lo = st.min + (st.max - st.min) / 2 - span / 2;
+    hi = lo + span;
+}
+
+static bool scaleFits(const HistoryStats &st)
+{
+    int32_t lo, hi;
+    wantedScale(st, lo, hi);
+    return st.min >= scaleMin && st.max <= scaleMax && (hi - lo) * 2 >= scaleMax - scaleMin;
+}
+
+static int8_t rowOf(int32_t value)
+{
+    int32_t row = (value - scaleMin) * (OLED_GRAPH_HEIGHT - 1) / (scaleMax - scaleMin);
+    return (int8_t)constrain(row, 0, OLED_GRAPH_HEIGHT - 1);
+}
+
+static void plot(uint16_t age)
+{
+    HistorySample s;
+    if (!historyGet(age, s))
+    {
+        return;
+    }
+    int8_t row = rowOf(historyValue(s, shownChannel));
+    oledRendererGraphColumn(cursor, lastRow < 0 ? row : lastRow, row);
+    cursor = (uint8_t)((cursor + 1) % TREND_COLUMNS);
+    oledRendererGraphColumn(cursor, -1, -1); // gap ahead of the newest sample
+    lastRow = row;
+}
+
+static void drawTitle()
+{
+    const ChannelStyle &style = styles[shownChannel];
+    char value[12] = "";
+    HistorySample s;
+    if (historyGet(0, s))
+    {
+        formatFixed(value, sizeof(value), historyValue(s, shownChannel), 2, VALUE_CHARS);
+    }
+    char title[sizeof(lastTitle)];
+    snprintf(title, sizeof(title), "%-5s %*s%s", style.label, VALUE_CHARS, value, style.unit);
+    if (strcmp(title, lastTitle) == 0)
+    {
+        return;
+    }
+    oledRendererText(0, 2, title);
+    strncpy(lastTitle, title, sizeof(lastTitle) - 1);
+    lastTitle[sizeof(lastTitle) - 1] = '\0';
+}
+
+bool trendGraphRender(HistoryChannel channel)
+{
+    uint32_t total = historyTotal();
+    HistoryStats st = historyStats(channel);
+    bool redraw = !oledRendererGraphShown() || channel != shownChannel;
+    if (!redraw && total == drawnTotal)
+    {
+        return false;
+    }
+    uint32_t fresh = total - drawnTotal;
+    if (total < drawnTotal || fresh >= TREND_COLUMNS || (st.count && !scaleFits(st)))
+    {
+        redraw = true; // history restarted, fell far behind, or the scale changed
+    }
+
+    uint16_t n = (uint16_t)min<uint32_t>(fresh, historyCount());
+    if (redraw)
+    {
+        shownChannel = channel;
+        oledRendererGraphBegin();
+        lastTitle[0] = '\0';
+        cursor = 0;
+        lastRow = -1;
+        if (st.count)
+        {
+            wantedScale(st, scaleMin, scaleMax);
+        }
+        n = min<uint16_t>(historyCount(), TREND_COLUMNS - 1);
+    }
+    while (n > 0)
+    {
+        plot(--n); // oldest first
+    }
+    drawnTotal = total;
+    drawTitle();
+    return true;
+}
@@ -0,0 +1,101 @@
+#include "ui_pages.h"
+
+struct Page
+{
+    const char *name;
+    uint16_t inputs;
+    PageRender render;
+    PageAvailable available;
+    uint8_t arg;
+};
+
+static Page pages[PAGE_MAX];
+static uint8_t pageCount = 0;
+static uint8_t current = 0;
+static volatile uint16_t pending = 0; // marked by the sampling and history threads too
+static bool full = true;
+
+int pagesAdd(const char *name, uint16_t inputs, PageRender render, uint8_t arg, PageAvailable available)
+{
+    if (pageCount >= PAGE_MAX)
+    {
+        return -1;
+    }
+    Page &p = pages[pageCount];
+    p.name = name;
+    p.inputs = inputs;
+    p.render = render;
+    p.available = available;
+    p.arg = arg;
+    return pageCount++;
+}
+
+bool pagesWants(uint16_t inputs)
+{
+    return pageCount && (pages[current].inputs & inputs) != 0;
+}
+
+bool pagesMark(uint16_t inputs)
+{
+    noInterrupts(); // one read-modify-write, whichever thread marks
+    pending |= inputs;
+    interrupts();
+    return pagesWants(inputs);
+}
+
+bool pagesRender()
+{
+    if (pageCount == 0)
+    {
+        return false;
+    }
+    Page &p = pages[current];
+    if (p.available && !p.available(p.arg))
+    {
+        // Its sensor went away; the first page is always there
+        current = 0;
+        full = true;
+        return pagesRender();
+    }
+    // Inputs of hidden pages go too: a page renders in full when it comes up
+    noInterrupts();
+    uint16_t marked = pending;
+    pending = 0;
+    interrupts();
+    if (!full && !(marked & p.inputs))
+    {
+        return false;
+    }
+    bool wasFull = full;
+    full = false;
+    return p.render(p.arg, wasFull);
+}
+
+void pagesNext()
+{
+    for (uint8_t step = 1; step <= pageCount; step++)
+    {
+        uint8_t next = (uint8_t)((current + step) % pageCount);
+        if (next == 0 || !pages[next].available || pages[next].available(pages[next].arg))
+        {
+            current = next;
+            break;
+        }
+    }
+    full = true;
+}
+
+void pagesInvalidate()
+{
+    full = true;
+}
+
+const char *pagesName()
+{
+    return pageCount ? pages[current].name : "";
+}
+
+uint8_t pagesArg()
+{
+    return pageCount ? pages[current].arg : 0;
+}
@@ -0,0 +1,200 @@
+// Hot-path regression suite for the native build: pio test -e native
+//
+// The stage budgets of bench.h are checked on the host clock, divided by
+// TEST_HOST_SPEEDUP since the host runs far faster than the 96 MHz
+// target; that catches algorithmic regressions, while "bench" on the
+// board stays the real measurement. The bus figures per sample are
+// measured on the simulated devices, as in sim_main.cpp, and held to the
+// same gates (sim_gates.h).
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+#include <unity.h>
+#include "sim_devices.h"
+#include "sim_gates.h"
+#include "bench.h"
+#include "i2c_bus.h"
+#include "sensors.h"
+#include "sampler.h"
+#include "oled_renderer.h"
+#include "telemetry.h"
+
+#ifndef TEST_HOST_SPEEDUP
+#define TEST_HOST_SPEEDUP 10
+#endif
+
+#define TEST_RUNS 1000
+#define TEST_SAMPLES 200
+
+#define BME_ADDR 0x76
+#define OLED_ADDR 0x3C
+
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t len) override { return len; }
+};
+
+static SimBme280 bme(BME_ADDR);
+static SimSh1106 panel(OLED_ADDR);
+static I2cBus bus;
+
+static const SensorReading base = {2150, 45u << 10, 101325u << 8}; // 21.5 C, 45 %RH, 1013.25 mBar
+
+// Alternates the values, as bench does, so every field is redrawn
+static SensorReading varied(uint32_t i)
+{
+    SensorReading v = base;
+    if (i & 1)
+    {
+        v.temperature += 111;
+        v.humidity += 11u << 10;
+        v.pressure += 1111u << 8;
+    }
+    return v;
+}
+
+static double hostUs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void checkBudget(const char *stage, double meanUs, uint32_t budgetUs)
+{
+    char msg[64];
+    snprintf(msg, sizeof msg, "%s mean %.3f us", stage, meanUs);
+    TEST_ASSERT_TRUE_MESSAGE(meanUs <= (double)budgetUs / TEST_HOST_SPEEDUP, msg);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_bring_up()
+{
+    TEST_ASSERT_EQUAL_UINT8(1, samplerStartSensors());
+    TEST_ASSERT_TRUE(oledRendererBegin(&Wire, OLED_ADDR));
+}
+
+static void test_compensate_budget()
+{
+    BmeRawFrame frame;
+    TEST_ASSERT_TRUE(sensorAt(0).bme.readFrame(frame));
+    SensorReading r;
+    volatile int32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < TEST_RUNS; i++)
+    {
+        frame.adcT += (i & 1) ? 16 : -16; // a new input each call, so none is folded away
+        TEST_ASSERT_TRUE(sensorAt(0).bme.compensate(frame, r));
+        sink = sink + r.temperature;
+    }
+    checkBudget("compensate", hostUs(start) / TEST_RUNS, BENCH_BUDGET_COMPENSATE_US);
+}
+
+static void test_render_budget()
+{
+    double total = 0;
+    for (uint32_t i = 0; i < TEST_RUNS; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        oledRendererSensorScreen(varied(i));
+        total += hostUs(start);
+        oledRendererFlushWait(); // the flush is not part of the render stage
+    }
+    checkBudget("render", total / TEST_RUNS, BENCH_BUDGET_RENDER_US);
+}
+
+static void test_telemetry_budget()
+{
+    NullPrint sink;
+    const TelemetryFormat formats[] = {TELEMETRY_TEXT, TELEMETRY_BINARY};
+    for (TelemetryFormat format : formats)
+    {
+        telemetrySetFormat(format);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < TEST_RUNS; i++)
+        {
+            SampleStamp stamp = {i, 1700000000u + i, 0};
+            telemetryWriteSample(sink, varied(i), stamp, 0);
+        }
+        checkBudget(format == TELEMETRY_TEXT ? "telemetry text" : "telemetry binary", hostUs(start) / TEST_RUNS,
+                    BENCH_BUDGET_TELEMETRY_US);
+    }
+    telemetrySetFormat(TELEMETRY_TEXT);
+}
+
+// Runs the profile for TEST_SAMPLES delivered samples and checks the
+// sensor traffic per sample and the conversions that were never read
+static void checkSampleBus(SamplingProfileId profile)
+{
+    TEST_ASSERT_TRUE(samplerSetProfile(profile));
+    const SimBusCounts before = bme.counts;
+    const uint32_t conversionsBefore = bme.conversions();
+    uint32_t delivered = 0;
+    while (delivered < TEST_SAMPLES)
+    {
+        uint32_t next = samplerNextPollUs();
+        if ((int32_t)(next - micros()) > 0)
+        {
+            simSetMicros(next);
+        }
+        uint8_t failed;
+        uint8_t fresh = samplerPoll(micros(), failed);
+        TEST_ASSERT_EQUAL_UINT8(0, failed);
+        delivered += fresh & 1;
+    }
+    const uint32_t transactions = bme.counts.transactions - before.transactions;
+    const uint32_t bytes =
+        bme.counts.bytesWritten + bme.counts.bytesRead - before.bytesWritten - before.bytesRead;
+    const uint32_t conversions = bme.conversions() - conversionsBefore;
+    const bool normal = samplingProfiles[profile].config.mode == BME280_MODE_NORMAL;
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(SIM_GATE_SENSOR_TRANSACTIONS * TEST_SAMPLES, transactions);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32((normal ? SIM_GATE_SENSOR_BYTES_NORMAL : SIM_GATE_SENSOR_BYTES) * TEST_SAMPLES,
+                                     bytes);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(delivered, conversions);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(conversions * SIM_GATE_MISSED_PERCENT / 100, conversions - delivered);
+}
+
+static void test_sample_bus_weather()
+{
+    checkSampleBus(PROFILE_WEATHER);
+}
+
+static void test_sample_bus_hvac()
+{
+    checkSampleBus(PROFILE_HVAC);
+}
+
+static void test_sample_bus_fast()
+{
+    checkSampleBus(PROFILE_FAST);
+}
+
+int main(int, char **)
+{
+    // Boot, as in setup(); the devices stay attached for every test
+    bme.defaultFrames(100);
+    Wire.attach(&bme);
+    Wire.attach(&panel);
+    NullPrint log;
+    I2cDevice devices[] = {
+        {"BME280", BME_ADDR, i2cProbeBme280, 0},
+        {"SH1106", OLED_ADDR, i2cProbeSh1106, 0},
+    };
+    i2cBusBegin(bus, &Wire);
+    i2cBusNegotiate(bus, devices, 2, log);
+    sensorsDiscover(&bus, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bring_up);
+    RUN_TEST(test_compensate_budget);
+    RUN_TEST(test_render_budget);
+    RUN_TEST(test_telemetry_budget);
+    RUN_TEST(test_sample_bus_weather);
+    RUN_TEST(test_sample_bus_hvac);
+    RUN_TEST(test_sample_bus_fast);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+"""Per-module RAM and flash report for the firmware image, with budgets.
+
+Runs after every link as a PlatformIO extra script: it parses the linker
+map, prints flash (.text, .rodata, .data load image) and RAM (.data,
+.bss) per object, with libraries grouped per archive, and fails the build
+when a total exceeds its budget:
+
+    custom_flash_budget  bytes of flash, default board_upload.maximum_size
+    custom_ram_budget    bytes of static RAM (.data + .bss)
+
+It also fails if one of the firmware's own objects references the heap
+(malloc, operator new, ...), since the firmware keeps every buffer in
+static storage (see include/heap_guard.h).
+
+Standalone, on an existing map file:
+
+    python3 tools/footprint.py .pio/build/blackpill_f411ce/firmware.map [ram_budget flash_budget]
+"""
+
+import os
+import re
+import subprocess
+import sys
+
+FLASH_SECTIONS = (".text", ".rodata", ".ARM.extab", ".ARM.exidx", ".isr_vector", ".init_array",
+                  ".fini_array", ".preinit_array", ".glue_7", ".vfp11_veneer", ".v4_bx")
+DATA_SECTIONS = (".data",)
+BSS_SECTIONS = (".bss", "COMMON")
+HEAP_SYMBOLS = ("malloc", "calloc", "realloc", "free", "_Znwj", "_Znaj", "_Znwm", "_Znam", "strdup")
+TOP_MODULES = 25
+
+# " .text.foo  0x08001234  0x54 path/to/file.o" or the same split over two lines
+ENTRY = re.compile(r"^\s(\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+SECTION_ONLY = re.compile(r"^\s(\.\S+|COMMON)\s*$")
+
+
+def module_name(path):
+    path = path.strip()
+    m = re.match(r"(.*?)\((.*)\)$", path)
+    if m:
+        return os.path.basename(m.group(1))  # one line per archive
+    name = os.path.basename(path)
+    return name[:-2] if name.endswith(".o") else name
+
+
+def kind(section):
+    for prefix in FLASH_SECTIONS:
+        if section.startswith(prefix):
+            return "flash"
+    for prefix in DATA_SECTIONS:
+        if section.startswith(prefix):
+            return "data"
+    for prefix in BSS_SECTIONS:
+        if section.startswith(prefix):
+            return "bss"
+    return None
+
+
+def parse_map(path):
+    """Returns {module: [flash, data, bss]} in bytes."""
+    modules = {}
+    in_map = False
+    pending = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+            line = line.rstrip("\n")
+            m = SECTION_ONLY.match(line)
+            if m:
+                pending = m.group(1)
+                continue
+            m = ENTRY.match(line)
+            if not m:
+                pending = None
+                continue
+            section = m.group(1) or pending
+            pending = None
+            size = int(m.group(3), 16)
+            where = m.group(4)
+            if not section or size == 0 or int(m.group(2), 16) == 0 or where.startswith("*"):
+                continue  # debug info, fill, linker-script symbols
+            k = kind(section)
+            if k is None:
+                continue
+            sizes = modules.setdefault(module_name(where), [0, 0, 0])
+            sizes[("flash", "data", "bss").index(k)] += size
+    return modules
+
+
+def report(modules, ram_budget, flash_budget, out=sys.stdout):
+    """Prints the table; returns False if a budget is exceeded."""
+    rows = sorted(modules.items(), key=lambda kv: -(kv[1][0] + 2 * kv[1][1] + kv[1][2]))
+    out.write("%-32s %8s %8s %8s\n" % ("module", "flash", "data", "bss"))
+    for name, (text, data, bss) in rows[:TOP_MODULES]:
+        out.write("%-32s %8d %8d %8d\n" % (name, text + data, data, bss))
+    if len(rows) > TOP_MODULES:
+        rest = rows[TOP_MODULES:]
+        out.write("%-32s %8d %8d %8d\n" % ("(%d more)" % len(rest), sum(r[1][0] + r[1][1] for r in rest),
+                                           sum(r[1][1] for r in rest), sum(r[1][2] for r in rest)))
+    flash = sum(v[0] + v[1] for v in modules.values())
+    ram = sum(v[1] + v[2] for v in modules.values())
+    ok = True
+    for label, used, budget in (("flash", flash, flash_budget), ("ram", ram, ram_budget)):
+        state = "ok"
+        if budget and used > budget:
+            state = "OVER BUDGET"
+            ok = False
+        out.write("footprint %s %d / %s bytes %s\n" % (label, used, budget or "-", state))
+    return ok
+
+
+def heap_users(nm, objects, env=None):
+    """Returns {object: [heap symbols it references]} for the firmware's own objects."""
+    users = {}
+    for obj in objects:
+        try:
+            undefined = subprocess.check_output([nm, "-u", obj], env=env, universal_newlines=True)
+        except (OSError, subprocess.CalledProcessError):
+            continue
+        found = [s for s in (l.split()[-1] for l in undefined.splitlines() if l.strip()) if s in HEAP_SYMBOLS]
+        if found:
+            users[os.path.basename(obj)] = found
+    return users
+
+
+def pio_main(env):
+    map_path = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+    env.Append(LINKFLAGS=["-Wl,-Map," + map_path])
+
+    def budget(option, default):
+        value = env.GetProjectOption(option, default)
+        return int(value) if value else 0
+
+    def post_link(source, target, env):
+        ram_budget = budget("custom_ram_budget", None)
+        flash_budget = budget("custom_flash_budget", env.BoardConfig().get("upload.maximum_size", 0))
+        ok = report(parse_map(map_path), ram_budget, flash_budget)
+        src_dir = os.path.join(env.subst("$BUILD_DIR"), "src")
+        objects = [os.path.join(root, f) for root, _, files in os.walk(src_dir) for f in files if f.endswith(".o")]
+        nm = env.subst("$CC").replace("gcc", "nm")
+        for obj, symbols in sorted(heap_users(nm, objects, env["ENV"]).items()):
+            print("footprint heap use in %s: %s" % (obj, ", ".join(symbols)))
+            ok = False
+        return 0 if ok else 1
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", post_link)
+
+
+try:
+    Import("env")  # noqa: F821 -- provided by PlatformIO
+    pio_main(env)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) < 2:
+            sys.exit(__doc__)
+        ram = int(sys.argv[2]) if len(sys.argv) > 2 else 0
+        flash = int(sys.argv[3]) if len(sys.argv) > 3 else 0
+        sys.exit(0 if report(parse_map(sys.argv[1]), ram, flash) else 1)
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""Decode the firmware's binary telemetry into Teleplot lines or CSV.
+
+Reads COBS-framed packets (0x00 delimited) from a serial port or a file,
+checks the CRC and prints one record per packet. Sequence gaps are
+reported on stderr so dropped frames are visible.
+
+    telemetry_decode.py /dev/ttyACM0              # Teleplot text on stdout
+    telemetry_decode.py --csv capture.bin > log.csv
+    telemetry_decode.py --log dump.bin > flash_log.csv  # output of "log dump"
+"""
+
+import argparse
+import struct
+import sys
+
+PKT_SAMPLE = 0x01
+SAMPLE_FORMAT = "<BHIIIhIHB"  # type, frame seq, sample seq, unix s, us, centi-degC, Pa Q24.8, centi-%RH, sensor
+SAMPLE_LEN = struct.calcsize(SAMPLE_FORMAT) + 2
+PKT_LOG = 0x02
+LOG_RECORD_FORMAT = "<IhH3sB"  # log seconds, centi-degC, centi-%RH, Pa uint24, sensor
+LOG_RECORD_LEN = struct.calcsize(LOG_RECORD_FORMAT)
+PKT_HEALTH = 0x03
+HEALTH_FORMAT = "<BBIIHHHHH"  # type, bus, ms, transactions, nacks, timeouts, errors, recoveries, kHz
+HEALTH_LEN = struct.calcsize(HEALTH_FORMAT) + 2
+PKT_DERIVED = 0x04
+DERIVED_HEADER = "<BIBB"  # type, sample seq, sensor, metric mask; then one int32 per metric in the mask
+# key, unit, CSV column, in DerivedMetric order; every value is in hundredths
+DERIVED_METRICS = (("Dewpoint", "C", "dewpoint_c"), ("AbsHum", "g/m3", "abs_hum_gm3"),
+                   ("HeatIndex", "C", "heat_index_c"), ("SeaLevel", "mBar", "sea_level_mbar"),
+                   ("Altitude", "m", "altitude_m"))
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            raise ValueError("bad COBS code")
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_sample(pkt):
+    if len(pkt) != SAMPLE_LEN:
+        raise ValueError("bad length %d" % len(pkt))
+    (crc,) = struct.unpack_from("<H", pkt, SAMPLE_LEN - 2)
+    if crc != crc16_ccitt(pkt[:SAMPLE_LEN - 2]):
+        raise ValueError("CRC mismatch")
+    _, seq, sample, secs, us, temp, press, hum, sensor = struct.unpack_from(SAMPLE_FORMAT, pkt)
+    return {
+        "seq": seq,
+        "sample": sample,
+        "sensor": sensor,
+        "time": secs + us / 1e6,  # RTC, unix seconds
+        "ms": secs * 1000 + us // 1000,  # the same in ms, as Teleplot expects
+        "temp": temp / 100.0,
+        "press": press / 256.0 / 100.0,  # mBar
+        "hum": hum / 100.0,
+    }
+
+
+def decode_health(pkt):
+    if len(pkt) != HEALTH_LEN:
+        raise ValueError("bad length %d" % len(pkt))
+    (crc,) = struct.unpack_from("<H", pkt, HEALTH_LEN - 2)
+    if crc != crc16_ccitt(pkt[:HEALTH_LEN - 2]):
+        raise ValueError("CRC mismatch")
+    _, bus, ms, xfer, nack, timeout, error, recover, khz = struct.unpack_from(HEALTH_FORMAT, pkt)
+    return {"bus": bus, "ms": ms, "xfer": xfer, "nack": nack, "timeout": timeout,
+            "error": error, "recover": recover, "khz": khz}
+
+
+def decode_derived(pkt):
+    if len(pkt) < struct.calcsize(DERIVED_HEADER) + 2:
+        raise ValueError("bad length %d" % len(pkt))
+    _, sample, sensor, mask = struct.unpack_from(DERIVED_HEADER, pkt)
+    indices = [i for i in range(len(DERIVED_METRICS)) if mask & (1 << i)]
+    if len(pkt) != struct.calcsize(DERIVED_HEADER) + 4 * len(indices) + 2:
+        raise ValueError("bad length %d" % len(pkt))
+    (crc,) = struct.unpack_from("<H", pkt, len(pkt) - 2)
+    if crc != crc16_ccitt(pkt[:-2]):
+        raise ValueError("CRC mismatch")
+    values = struct.unpack_from("<%di" % len(indices), pkt, struct.calcsize(DERIVED_HEADER))
+    return {"sample": sample, "sensor": sensor, "values": {i: v / 100.0 for i, v in zip(indices, values)}}
+
+
+def print_health(h, out):
+    for key in ("xfer", "nack", "timeout", "error", "recover", "khz"):
+        print(">I2C%d_%s:%d:%d" % (h["bus"], key, h["ms"], h[key]), file=out)
+
+
+def decode_log(pkt):
+    if len(pkt) < 4 or len(pkt) != 4 + pkt[1] * LOG_RECORD_LEN:
+        raise ValueError("bad length %d" % len(pkt))
+    (crc,) = struct.unpack_from("<H", pkt, len(pkt) - 2)
+    if crc != crc16_ccitt(pkt[:-2]):
+        raise ValueError("CRC mismatch")
+    records = []
+    for i in range(pkt[1]):
+        t, temp, hum, press, sensor = struct.unpack_from(LOG_RECORD_FORMAT, pkt, 2 + i * LOG_RECORD_LEN)
+        records.append({
+            "time": t,
+            "sensor": sensor,
+            "temp": temp / 100.0,
+            "press": int.from_bytes(press, "little") / 100.0,  # mBar
+            "hum": hum / 100.0,
+        })
+    return records
+
+
+def frames(stream):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(64)
+        if not chunk:
+            return
+        for b in chunk:
+            if b == 0:
+                if buf:
+                    yield bytes(buf)
+                buf.clear()
+            else:
+                buf.append(b)
+
+
+def open_source(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial, only needed for live ports
+
+        return serial.Serial(path, baud, timeout=1)
+    return open(path, "rb")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("source", help="serial port, capture file, or - for stdin")
+    ap.add_argument("--csv", action="store_true", help="print CSV instead of Teleplot")
+    ap.add_argument("--log", action="store_true", help="print flash log dump records as CSV")
+    ap.add_argument("--baud", type=int, default=115200)
+    args = ap.parse_args()
+
+    if args.log:
+        print("time_s,sensor,pressure_mbar,temp_c,hum_pct")
+    elif args.csv:
+        print("seq,sample,sensor,time_s,pressure_mbar,temp_c,hum_pct," + ",".join(m[2] for m in DERIVED_METRICS))
+    last_seq = None
+    last_sample = None
+    row = None  # CSV row of the last sample, completed by its derived packet
+    last_ms = 0
+    for frame in frames(open_source(args.source, args.baud)):
+        try:
+            pkt = cobs_decode(frame)
+            if pkt and pkt[0] == PKT_HEALTH and not args.log:
+                # bus health goes to stderr in CSV mode, so the CSV stays clean
+                print_health(decode_health(pkt), sys.stderr if args.csv else sys.stdout)
+                continue
+            if pkt and pkt[0] == PKT_DERIVED and not args.log:
+                d = decode_derived(pkt)
+                if args.csv:
+                    if row and row[0] == d["sample"]:
+                        row[1].extend("%.2f" % d["values"][i] if i in d["values"] else ""
+                                      for i in range(len(DERIVED_METRICS)))
+                        print(",".join(row[1]))
+                        row = None
+                    continue
+                suffix = "_%d" % d["sensor"] if d["sensor"] else ""
+                for i, v in sorted(d["values"].items()):
+                    key, unit, _ = DERIVED_METRICS[i]
+                    print(">%s%s:%d:%.2f§%s" % (key, suffix, last_ms, v, unit))
+                continue
+            if not pkt or pkt[0] != (PKT_LOG if args.log else PKT_SAMPLE):
+                continue
+            if args.log:
+                for r in decode_log(pkt):
+                    print("%d,%d,%.2f,%.2f,%.2f" % (r["time"], r["sensor"], r["press"], r["temp"], r["hum"]))
+                continue
+            s = decode_sample(pkt)
+        except ValueError as e:
+            if all(32 <= b < 127 or b in (9, 10, 13) for b in frame):
+                # console replies are plain text between binary frames
+                sys.stderr.write(frame.decode("ascii"))
+            else:
+                print("dropped frame: %s" % e, file=sys.stderr)
+            continue
+        if last_seq is not None and s["seq"] != (last_seq + 1) & 0xFFFF:
+            print("sequence gap: %d -> %d" % (last_seq, s["seq"]), file=sys.stderr)
+        last_seq = s["seq"]
+        if last_sample is not None and s["sample"] < last_sample:
+            print("sample sequence restarted, the board rebooted", file=sys.stderr)
+        last_sample = s["sample"]
+        last_ms = s["ms"]
+        if args.csv:
+            if row:
+                print(",".join(row[1] + [""] * len(DERIVED_METRICS)))
+            row = (s["sample"], ["%d,%d,%d,%.6f,%.5f,%.2f,%.2f" % (s["seq"], s["sample"], s["sensor"], s["time"],
+                                                                   s["press"], s["temp"], s["hum"])])
+        else:
+            suffix = "_%d" % s["sensor"] if s["sensor"] else ""
+            print(">Pressure%s:%d:%.5f§mBar" % (suffix, s["ms"], s["press"]))
+            print(">Temp%s:%d:%.2f§C" % (suffix, s["ms"], s["temp"]))
+            print(">Hum%s:%d:%.2f§%%" % (suffix, s["ms"], s["hum"]))
+        sys.stdout.flush()
+    if row:
+        print(",".join(row[1] + [""] * len(DERIVED_METRICS)))
+
+
+if __name__ == "__main__":
+    main()